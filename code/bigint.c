@@ -0,0 +1,130 @@
+#include "bigint.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*!
+ * Agrandit a pour qu'il puisse contenir size chiffres, les nouveaux chiffres
+ * valent zéro.
+ */
+static void bigint_reserve(lu_bigint *a, unsigned int size)
+{
+   if (size > a->max_size) {
+      a->digit = (unsigned int *) realloc(a->digit, sizeof(unsigned int) * size);
+      a->max_size = size;
+   }
+   if (size > a->size) {
+      memset(a->digit + a->size, 0, sizeof(unsigned int) * (size - a->size));
+   }
+}
+
+/*!
+ * Retire les chiffres nuls de poids fort.
+ */
+static __inline void bigint_trim(lu_bigint *a)
+{
+   while (a->size > 0 && a->digit[a->size - 1] == 0) {
+      --a->size;
+   }
+}
+
+lu_bigint bigint_new(unsigned long long v)
+{
+   lu_bigint a = { NULL, 0, 0 };
+
+   bigint_reserve(&a, 3);
+   while (v > 0) {
+      a.digit[a.size++] = v % BIGINT_BASE;
+      v /= BIGINT_BASE;
+   }
+   return a;
+}
+
+void bigint_delete(lu_bigint *a)
+{
+   free(a->digit);
+   a->digit = NULL;
+   a->size = a->max_size = 0;
+}
+
+void bigint_add(lu_bigint *a, const lu_bigint *b)
+{
+   unsigned int i, size = (a->size > b->size ? a->size : b->size) + 1;
+   unsigned long long carry = 0;
+
+   bigint_reserve(a, size);
+   for (i = 0; i < size; ++i) {
+      carry += (unsigned long long) a->digit[i] + (i < b->size ? b->digit[i] : 0);
+      a->digit[i] = carry % BIGINT_BASE;
+      carry /= BIGINT_BASE;
+   }
+   a->size = size;
+   bigint_trim(a);
+}
+
+void bigint_add_mul(lu_bigint *a, const lu_bigint *b, unsigned long long v)
+{
+   lu_bigint prod;
+
+   if (v == 0 || bigint_is_zero(b)) {
+      return;
+   }
+   if (v == 1) {
+      bigint_add(a, b);
+      return;
+   }
+   prod = bigint_new(v);
+   bigint_mul(&prod, b);
+   bigint_add(a, &prod);
+   bigint_delete(&prod);
+}
+
+void bigint_mul(lu_bigint *a, const lu_bigint *b)
+{
+   unsigned int i, j, size = a->size + b->size;
+   unsigned long long *acc, carry = 0;
+
+   if (bigint_is_zero(a) || bigint_is_zero(b)) {
+      a->size = 0;
+      return;
+   }
+
+   // un produit de chiffres tient sur 60 bits : on propage la retenue à
+   // chaque ligne
+   acc = (unsigned long long *) calloc(size + 1, sizeof(unsigned long long));
+   for (i = 0; i < a->size; ++i) {
+      carry = 0;
+      for (j = 0; j < b->size; ++j) {
+         carry += acc[i + j] + (unsigned long long) a->digit[i] * b->digit[j];
+         acc[i + j] = carry % BIGINT_BASE;
+         carry /= BIGINT_BASE;
+      }
+      for (j = i + b->size; carry > 0; ++j) {
+         carry += acc[j];
+         acc[j] = carry % BIGINT_BASE;
+         carry /= BIGINT_BASE;
+      }
+   }
+
+   bigint_reserve(a, size);
+   for (i = 0; i < size; ++i) {
+      a->digit[i] = acc[i];
+   }
+   a->size = size;
+   bigint_trim(a);
+   free(acc);
+}
+
+void bigint_print(FILE *fd, const lu_bigint *a)
+{
+   unsigned int i;
+
+   if (bigint_is_zero(a)) {
+      fprintf(fd, "0");
+      return;
+   }
+   fprintf(fd, "%u", a->digit[a->size - 1]);
+   for (i = a->size - 1; i-- > 0;) {
+      fprintf(fd, "%09u", a->digit[i]);
+   }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdio.h>
+
+/** Base des chiffres d'un grand entier */
+#define BIGINT_BASE 1000000000u
+
+/*!
+ * \struct lu_bigint Entier naturel de taille quelconque, en base BIGINT_BASE
+ * (chiffre de poids faible en premier). Zéro n'a aucun chiffre.
+ */
+typedef struct {
+   unsigned int *digit;    /*!< chiffres */
+   unsigned int size;      /*!< nombre de chiffres */
+   unsigned int max_size;  /*!< taille allouée */
+} lu_bigint;
+
+/*!
+ * Crée un grand entier valant v.
+ */
+lu_bigint bigint_new(unsigned long long v);
+
+/*!
+ * Libère la mémoire utilisée par un grand entier.
+ */
+void bigint_delete(lu_bigint *a);
+
+/*!
+ * Renvoie 1 si a vaut zéro.
+ */
+static __inline int bigint_is_zero(const lu_bigint *a)
+{
+   return a->size == 0;
+}
+
+/*!
+ * a += b
+ */
+void bigint_add(lu_bigint *a, const lu_bigint *b);
+
+/*!
+ * a += b * v
+ */
+void bigint_add_mul(lu_bigint *a, const lu_bigint *b, unsigned long long v);
+
+/*!
+ * a *= b
+ */
+void bigint_mul(lu_bigint *a, const lu_bigint *b);
+
+/*!
+ * Écrit a en base 10.
+ */
+void bigint_print(FILE *fd, const lu_bigint *a);
@@ -0,0 +1,145 @@
+#include "bitboard.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*!
+ * Renvoie le masque de la suite de cases contenant la case x, bornée par les
+ * murs ou les bords.
+ *
+ * \param walls Masque des murs de la ligne/colonne.
+ * \param x Position de la case dans la ligne/colonne.
+ * \param n Taille de la ligne/colonne.
+ */
+static __inline lu_bits bb_run(lu_bits walls, unsigned int x, unsigned int n)
+{
+   lu_bits all = (n == BB_MAX) ? ~0ULL : ((1ULL << n) - 1);
+   lu_bits above = walls & ~((2ULL << x) - 1);
+   lu_bits below = walls & ((1ULL << x) - 1);
+
+   // tout ce qui est avant le premier mur après x
+   lu_bits hi = above ? (above & -above) - 1 : all;
+   // tout ce qui est après le dernier mur avant x
+   lu_bits lo = below ? ~((2ULL << (63 - __builtin_clzll(below))) - 1) : ~0ULL;
+
+   return hi & lo & all;
+}
+
+lu_bitboard *bb_new(const lu_puzzle *p)
+{
+   unsigned int x, y;
+
+   if (p->width > BB_MAX || p->height > BB_MAX) {
+      return NULL;
+   }
+
+   lu_bitboard *bb = (lu_bitboard *) malloc(sizeof(*bb));
+   bb->width = p->width;
+   bb->height = p->height;
+
+   // un seul bloc pour les 6 familles de masques
+   bb->lit_r = (lu_bits *) calloc(3 * (p->width + p->height), sizeof(lu_bits));
+   bb->wall_r = bb->lit_r + p->height;
+   bb->target_r = bb->wall_r + p->height;
+   bb->lit_c = bb->target_r + p->height;
+   bb->wall_c = bb->lit_c + p->width;
+   bb->target_c = bb->wall_c + p->width;
+
+   for (y = 0; y < p->height; ++y) {
+      for (x = 0; x < p->width; ++x) {
+         lu_square sq = p->data[y * p->width + x];
+
+         if (sq <= lusq_block_any) {
+            bb->wall_r[y] |= 1ULL << x;
+            bb->wall_c[x] |= 1ULL << y;
+         } else if (sq == lusq_lbulb || sq == lusq_enlighted) {
+            bb->lit_r[y] |= 1ULL << x;
+            bb->lit_c[x] |= 1ULL << y;
+         }
+      }
+   }
+
+   return bb;
+}
+
+void bb_destroy(lu_bitboard *bb)
+{
+   if (bb != NULL) {
+      free(bb->lit_r);
+      free(bb);
+   }
+}
+
+int bb_set_targets(lu_bitboard *bb, position_array pa_empty, position_array pa_impossible)
+{
+   unsigned int index;
+   int count = 0;
+   position pos;
+
+   memset(bb->target_r, 0, sizeof(lu_bits) * bb->height);
+   memset(bb->target_c, 0, sizeof(lu_bits) * bb->width);
+
+   for (index = 0; index < pa_empty.size; ++index) {
+      pos = pa_empty.array[index];
+      bb->target_r[pos.line] |= 1ULL << pos.column;
+      bb->target_c[pos.column] |= 1ULL << pos.line;
+   }
+   for (index = 0; index < pa_impossible.size; ++index) {
+      pos = pa_impossible.array[index];
+      bb->target_r[pos.line] |= 1ULL << pos.column;
+      bb->target_c[pos.column] |= 1ULL << pos.line;
+   }
+
+   for (index = 0; index < bb->height; ++index) {
+      count += __builtin_popcountll(bb->target_r[index] & ~bb->lit_r[index]);
+   }
+
+   return count;
+}
+
+int bb_light_on(lu_bitboard *bb, unsigned int x, unsigned int y, lu_bits *undo_h, lu_bits *undo_v)
+{
+   lu_bits nh, nv, bits;
+   int count;
+
+   // ligne : l'ampoule est comptée ici
+   nh = bb_run(bb->wall_r[y], x, bb->width) & ~bb->lit_r[y];
+   bb->lit_r[y] |= nh;
+   for (bits = nh; bits; bits &= bits - 1) {
+      bb->lit_c[__builtin_ctzll(bits)] |= 1ULL << y;
+   }
+
+   // colonne : la case de l'ampoule est déjà allumée
+   nv = bb_run(bb->wall_c[x], y, bb->height) & ~bb->lit_c[x];
+   bb->lit_c[x] |= nv;
+   for (bits = nv; bits; bits &= bits - 1) {
+      bb->lit_r[__builtin_ctzll(bits)] |= 1ULL << x;
+   }
+
+   count = __builtin_popcountll(nh & bb->target_r[y])
+      + __builtin_popcountll(nv & bb->target_c[x]);
+
+   *undo_h = nh;
+   *undo_v = nv;
+
+   return count;
+}
+
+int bb_light_off(lu_bitboard *bb, unsigned int x, unsigned int y, lu_bits undo_h, lu_bits undo_v)
+{
+   lu_bits bits;
+
+   // ordre inverse de bb_light_on()
+   bb->lit_c[x] &= ~undo_v;
+   for (bits = undo_v; bits; bits &= bits - 1) {
+      bb->lit_r[__builtin_ctzll(bits)] &= ~(1ULL << x);
+   }
+
+   bb->lit_r[y] &= ~undo_h;
+   for (bits = undo_h; bits; bits &= bits - 1) {
+      bb->lit_c[__builtin_ctzll(bits)] &= ~(1ULL << y);
+   }
+
+   return __builtin_popcountll(undo_h & bb->target_r[y])
+      + __builtin_popcountll(undo_v & bb->target_c[x]);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "lightup.h"
+#include "utils.h"
+
+/** Nombre maximum de cases par ligne/colonne gérées par les bitboards */
+#define BB_MAX 64
+
+/*!
+ * lu_bits Masque de bits d'une ligne ou d'une colonne du puzzle. Le bit x
+ * du masque de la ligne y correspond à la case (x, y), tout comme le bit y du
+ * masque de la colonne x.
+ */
+typedef unsigned long long lu_bits;
+
+/*!
+ * \struct lu_bitboard État du solver sous forme de masques de bits. On
+ * maintient un masque par ligne et par colonne pour les cases allumées
+ * (ampoules comprises) et les murs. Les cases "cibles" sont les
+ * cases de la classe en cours de résolution qui doivent être éclairées.
+ * Utilisable uniquement si la largeur et la hauteur sont <= BB_MAX.
+ */
+typedef struct {
+   unsigned int width;     /*!< largeur (en nombre de cases) */
+   unsigned int height;    /*!< hauteur (en nombre de cases) */
+   lu_bits *lit_r;         /*!< cases allumées, par ligne */
+   lu_bits *lit_c;         /*!< cases allumées, par colonne */
+   lu_bits *wall_r;        /*!< murs, par ligne */
+   lu_bits *wall_c;        /*!< murs, par colonne */
+   lu_bits *target_r;      /*!< cases à éclairer, par ligne */
+   lu_bits *target_c;      /*!< cases à éclairer, par colonne */
+} lu_bitboard;
+
+/*!
+ * Construit les bitboards d'un puzzle : murs, ampoules et cases déjà
+ * allumées sont lus dans p->data. Aucune case n'est cible.
+ *
+ * \param p Le puzzle.
+ * \return Les bitboards du puzzle ou NULL si le puzzle est trop grand.
+ */
+lu_bitboard *bb_new(const lu_puzzle *p);
+
+/*!
+ * Libère la mémoire utilisée par des bitboards.
+ *
+ * \param bb Les bitboards à libérer.
+ */
+void bb_destroy(lu_bitboard *bb);
+
+/*!
+ * Marque les cases d'une classe comme cases à éclairer.
+ *
+ * \param bb Les bitboards.
+ * \param pa_empty Cases vides de la classe.
+ * \param pa_impossible Cases impossibles de la classe.
+ * \return Le nombre de cases cibles non éclairées.
+ */
+int bb_set_targets(lu_bitboard *bb, position_array pa_empty, position_array pa_impossible);
+
+/*!
+ * Place une ampoule et éclaire sa ligne et sa colonne jusqu'aux murs.
+ *
+ * \param bb Les bitboards.
+ * \param x Abscisse de l'ampoule.
+ * \param y Ordonnée de l'ampoule.
+ * \param[out] undo_h Cases de la ligne nouvellement allumées.
+ * \param[out] undo_v Cases de la colonne nouvellement allumées.
+ * \return Le nombre de cases cibles nouvellement allumées.
+ */
+int bb_light_on(lu_bitboard *bb, unsigned int x, unsigned int y, lu_bits *undo_h, lu_bits *undo_v);
+
+/*!
+ * Retire une ampoule placée par bb_light_on().
+ *
+ * \param bb Les bitboards.
+ * \param x Abscisse de l'ampoule.
+ * \param y Ordonnée de l'ampoule.
+ * \param undo_h Masque renvoyé par bb_light_on().
+ * \param undo_v Masque renvoyé par bb_light_on().
+ * \return Le nombre de cases cibles qui redeviennent sombres.
+ */
+int bb_light_off(lu_bitboard *bb, unsigned int x, unsigned int y, lu_bits undo_h, lu_bits undo_v);
+
+/*!
+ * Renvoie 1 si la case (x, y) est allumée (ou porte une ampoule).
+ */
+static __inline int bb_is_lit(const lu_bitboard *bb, unsigned int x, unsigned int y)
+{
+   return (bb->lit_r[y] >> x) & 1;
+}
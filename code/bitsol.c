@@ -0,0 +1,36 @@
+#include "bitsol.h"
+
+#include <stdlib.h>
+
+lu_bitsol bitsol_from_list(const int_array *solutions, unsigned int nb_cells)
+{
+   lu_bitsol bs;
+   const int *s;
+   lu_bits *cur;
+
+   bs.nb_cells = nb_cells;
+   bs.nb_words = (nb_cells + 63) / 64;
+   bs.size = 0;
+   for (s = solutions->array; *s != -2; ++s) {
+      bs.size += *s == -1;
+   }
+
+   bs.bits = (lu_bits *) calloc((unsigned long) bs.size * bs.nb_words + 1, sizeof(lu_bits));
+   cur = bs.bits;
+   for (s = solutions->array; *s != -2; ++s) {
+      if (*s == -1) {
+         cur += bs.nb_words;
+      } else {
+         cur[*s / 64] |= 1ULL << (*s % 64);
+      }
+   }
+
+   return bs;
+}
+
+void bitsol_delete(lu_bitsol *bs)
+{
+   free(bs->bits);
+   bs->bits = NULL;
+   bs->size = 0;
+}
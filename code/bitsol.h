@@ -0,0 +1,51 @@
+#pragma once
+
+#include "bitboard.h"
+#include "utils.h"
+
+/*!
+ * \struct lu_bitsol Solutions d'une classe sous forme de masques de bits :
+ * le bit i d'une solution vaut 1 si la case pa_empty.array[i] porte une
+ * ampoule. Les solutions sont rangées à la suite, nb_words mots chacune.
+ */
+typedef struct {
+   unsigned int nb_cells;  /*!< cases vides de la classe */
+   unsigned int nb_words;  /*!< mots par solution */
+   unsigned int size;      /*!< nombre de solutions */
+   lu_bits *bits;          /*!< les solutions */
+} lu_bitsol;
+
+/*!
+ * Convertit une liste de solutions (index dans pa_empty, -1 entre deux
+ * solutions, -2 à la fin).
+ *
+ * \param solutions La liste.
+ * \param nb_cells Nombre de cases vides de la classe.
+ */
+lu_bitsol bitsol_from_list(const int_array *solutions, unsigned int nb_cells);
+
+/*!
+ * Libère la mémoire utilisée par les solutions.
+ */
+void bitsol_delete(lu_bitsol *bs);
+
+/*!
+ * Masque de la solution k.
+ */
+static __inline const lu_bits *bitsol_get(const lu_bitsol *bs, unsigned int k)
+{
+   return bs->bits + (unsigned long) k * bs->nb_words;
+}
+
+/*!
+ * Nombre de cases du masque présentes dans la solution s.
+ */
+static __inline unsigned int bitsol_count(const lu_bits *s, const lu_bits *mask, unsigned int nb_words)
+{
+   unsigned int w, count = 0;
+
+   for (w = 0; w < nb_words; ++w) {
+      count += __builtin_popcountll(s[w] & mask[w]);
+   }
+   return count;
+}
@@ -0,0 +1,434 @@
+#include "cbj.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/** Raison du retrait d'une case par le nogood k */
+#define CBJ_NOGOOD(walls, k) COVER_WALL((walls)->nb_walls + (k))
+
+lu_cbj *cbj_new(lu_cover *cover, unsigned int nb_cells)
+{
+   unsigned int n = nb_cells + 1;
+
+   lu_cbj *cbj = (lu_cbj *) malloc(sizeof(*cbj));
+   cbj->cover = cover;
+   cbj->nb_cells = nb_cells;
+   cbj->level = (int *) malloc(sizeof(int) * n);
+   memset(cbj->level, 0xff, sizeof(int) * n);
+   cbj->cell = (int *) malloc(sizeof(int) * n);
+   cbj->skip = (unsigned char *) calloc(n, sizeof(unsigned char));
+   cbj->learned = (unsigned char *) calloc(n, sizeof(unsigned char));
+   cbj->start = (unsigned int *) malloc(sizeof(unsigned int) * n);
+   cbj->cs_first = (unsigned int *) malloc(sizeof(unsigned int) * n);
+   cbj->cs_size = (unsigned int *) calloc(n, sizeof(unsigned int));
+   cbj->mark = (unsigned char *) calloc(n, sizeof(unsigned char));
+   cbj->pool = new_int_array();
+   cbj->cs = new_int_array_with_size(n);
+   cbj->cs_max = -1;
+   cbj->seen = new_int_array_with_size(n);
+   cbj->work = new_int_array_with_size(n);
+   cbj->lits = new_int_array();
+   cbj->first = new_int_array();
+   cbj->head = (int *) malloc(sizeof(int) * n);
+   memset(cbj->head, 0xff, sizeof(int) * n);
+   cbj->next = new_int_array();
+
+   return cbj;
+}
+
+void cbj_destroy(lu_cbj *cbj)
+{
+   if (cbj != NULL) {
+      free(cbj->level);
+      free(cbj->cell);
+      free(cbj->skip);
+      free(cbj->learned);
+      free(cbj->start);
+      free(cbj->cs_first);
+      free(cbj->cs_size);
+      free(cbj->mark);
+      delete_int_array(&cbj->pool);
+      delete_int_array(&cbj->cs);
+      delete_int_array(&cbj->seen);
+      delete_int_array(&cbj->work);
+      delete_int_array(&cbj->lits);
+      delete_int_array(&cbj->first);
+      free(cbj->head);
+      delete_int_array(&cbj->next);
+      free(cbj);
+   }
+}
+
+/*!
+ * Renvoie 1 si la case porte une ampoule posée par la recherche.
+ */
+static __inline int cbj_is_bulb(const lu_cover *cover, unsigned int c)
+{
+   return !cover->cand[c] && cover->cause[c] == (int) c;
+}
+
+/*!
+ * Niveau de la décision prise sur une case de la classe.
+ */
+static __inline int cbj_level_of(const lu_cbj *cbj, unsigned int c)
+{
+   return cbj->level[cbj->cover->rank[c]];
+}
+
+/*!
+ * Ajoute un niveau à l'ensemble de conflit courant. Une case écartée après
+ * l'échec de sa branche ampoule est remplacée par l'ensemble de conflit de
+ * cette branche.
+ */
+static void cbj_add_level(lu_cbj *cbj, int l)
+{
+   unsigned int i;
+
+   add_to_int_array(&cbj->work, l);
+   while (cbj->work.size > 0) {
+      l = cbj->work.array[--cbj->work.size];
+      if (l < 0 || cbj->mark[l]) {
+         continue;
+      }
+      cbj->mark[l] = 1;
+      add_to_int_array(&cbj->seen, l);
+      if (cbj->learned[l]) {
+         for (i = 0; i < cbj->cs_size[l]; ++i) {
+            add_to_int_array(&cbj->work, cbj->pool.array[cbj->cs_first[l] + i]);
+         }
+      } else {
+         add_to_int_array(&cbj->cs, l);
+         if (l > cbj->cs_max) {
+            cbj->cs_max = l;
+         }
+      }
+   }
+}
+
+/*!
+ * Ajoute les niveaux qui expliquent pourquoi la case c ne peut pas recevoir
+ * d'ampoule (ou la porte).
+ */
+static void cbj_explain(lu_cbj *cbj, const lu_puzzle *p, unsigned int c)
+{
+   const lu_cover *cover = cbj->cover;
+   const lu_walls *walls = cover->walls;
+   int cause = cover->cause[c];
+   unsigned int i, w, cell, x, y, base, len;
+
+   if (cause >= 0) {
+      cbj_add_level(cbj, cbj_level_of(cbj, cause));
+   } else if (cause == COVER_SKIPPED) {
+      cbj_add_level(cbj, cbj_level_of(cbj, c));
+   } else if (cause != COVER_NONE) {
+      w = COVER_WALL(0) - cause;
+      if (w < walls->nb_walls) {
+         // les ampoules qui saturent le mur
+         cell = walls->cell[w];
+         x = cell % p->width;
+         y = cell / p->width;
+         if (x >= 1 && cbj_is_bulb(cover, cell - 1)) cbj_add_level(cbj, cbj_level_of(cbj, cell - 1));
+         if (x + 1 < p->width && cbj_is_bulb(cover, cell + 1)) cbj_add_level(cbj, cbj_level_of(cbj, cell + 1));
+         if (y >= 1 && cbj_is_bulb(cover, cell - p->width)) cbj_add_level(cbj, cbj_level_of(cbj, cell - p->width));
+         if (y + 1 < p->height && cbj_is_bulb(cover, cell + p->width)) cbj_add_level(cbj, cbj_level_of(cbj, cell + p->width));
+      } else {
+         // les autres ampoules du nogood
+         base = cbj->first.array[w - walls->nb_walls];
+         len = cbj->lits.array[base];
+         for (i = 1; i <= len; ++i) {
+            if (cbj->lits.array[base + i] != (int) c) {
+               cbj_add_level(cbj, cbj_level_of(cbj, cbj->lits.array[base + i]));
+            }
+         }
+      }
+   }
+}
+
+/*!
+ * Explique les cases qui ne peuvent plus recevoir d'ampoule, sans les
+ * ampoules elles-mêmes.
+ */
+static __inline void cbj_explain_closed(lu_cbj *cbj, const lu_puzzle *p, unsigned int c)
+{
+   if (p->data[c] == lusq_empty && !cbj->cover->cand[c] && !cbj_is_bulb(cbj->cover, c)) {
+      cbj_explain(cbj, p, c);
+   }
+}
+
+/*!
+ * Calcule l'ensemble de conflit de la contradiction notée par la couverture
+ * (cbj->cs, cbj->cs_max).
+ *
+ * \return 0 si la contradiction n'est pas connue.
+ */
+static int cbj_analyze(lu_cbj *cbj, const lu_puzzle *p)
+{
+   const lu_cover *cover = cbj->cover;
+   const lu_segments *segs = cover->segs;
+   const lu_walls *walls = cover->walls;
+   int conflict = cover->conflict;
+   unsigned int i, n, c, s, step, w, x, y, base, len;
+
+   cbj->cs.size = 0;
+   cbj->cs_max = -1;
+   if (conflict == COVER_NONE) {
+      return 0;
+   }
+
+   if (conflict >= 0) {
+      // case sombre : aucune case de ses deux segments ne peut recevoir d'ampoule
+      for (i = 0; i < 2; ++i) {
+         s = (i == 0) ? segs->hseg[conflict] : segs->vseg[conflict];
+         step = segments_step(segs, s);
+         for (n = 0, c = segs->first[s]; n < segs->length[s]; ++n, c += step) {
+            cbj_explain_closed(cbj, p, c);
+         }
+      }
+   } else {
+      w = COVER_WALL(0) - conflict;
+      if (w < walls->nb_walls) {
+         // mur : ses voisins fermés le privent des ampoules qui lui manquent
+         c = walls->cell[w];
+         x = c % p->width;
+         y = c / p->width;
+         if (x >= 1) cbj_explain_closed(cbj, p, c - 1);
+         if (x + 1 < p->width) cbj_explain_closed(cbj, p, c + 1);
+         if (y >= 1) cbj_explain_closed(cbj, p, c - p->width);
+         if (y + 1 < p->height) cbj_explain_closed(cbj, p, c + p->width);
+      } else {
+         // nogood : toutes ses ampoules sont posées
+         base = cbj->first.array[w - walls->nb_walls];
+         len = cbj->lits.array[base];
+         for (i = 1; i <= len; ++i) {
+            cbj_add_level(cbj, cbj_level_of(cbj, cbj->lits.array[base + i]));
+         }
+      }
+   }
+
+   for (i = 0; i < cbj->seen.size; ++i) {
+      cbj->mark[cbj->seen.array[i]] = 0;
+   }
+   cbj->seen.size = 0;
+   return 1;
+}
+
+/*!
+ * Ajoute une surveillance du nogood en tête de la liste de la case c.
+ */
+static __inline void cbj_watch(lu_cbj *cbj, unsigned int c, int node)
+{
+   int r = cbj->cover->rank[c];
+
+   cbj->next.array[node] = cbj->head[r];
+   cbj->head[r] = node;
+}
+
+/*!
+ * La branche ampoule du niveau l a échoué sur l'ensemble de conflit cs (qui
+ * contient l) : garde cs sans l comme raison de la case écartée, et apprend
+ * cs comme nogood s'il ne contient que des ampoules.
+ */
+static void cbj_learn(lu_cbj *cbj, int l)
+{
+   unsigned int i, base;
+   int k, second = -1, bulbs_only = 1;
+
+   cbj->cs_first[l] = cbj->pool.size;
+   cbj->cs_size[l] = 0;
+   for (i = 0; i < cbj->cs.size; ++i) {
+      k = cbj->cs.array[i];
+      if (k == l) {
+         continue;
+      }
+      add_to_int_array(&cbj->pool, k);
+      ++cbj->cs_size[l];
+      bulbs_only &= !cbj->skip[k];
+      if (k > second) {
+         second = k;
+      }
+   }
+   cbj->learned[l] = 1;
+
+   if (!bulbs_only || second < 0 || cbj->cs.size > CBJ_NOGOOD_MAX || cbj->first.size >= CBJ_NOGOODS_MAX) {
+      return;
+   }
+
+   // la case du niveau l et celle du niveau le plus profond après lui sont
+   // surveillées : ce sont les deux dernières ampoules posées
+   k = cbj->first.size;
+   base = cbj->lits.size;
+   add_to_int_array(&cbj->first, base);
+   add_to_int_array(&cbj->lits, cbj->cs.size);
+   add_to_int_array(&cbj->lits, cbj->cell[l]);
+   add_to_int_array(&cbj->lits, cbj->cell[second]);
+   for (i = 0; i < cbj->cs.size; ++i) {
+      if (cbj->cs.array[i] != l && cbj->cs.array[i] != second) {
+         add_to_int_array(&cbj->lits, cbj->cell[cbj->cs.array[i]]);
+      }
+   }
+   add_to_int_array(&cbj->next, -1);
+   add_to_int_array(&cbj->next, -1);
+   cbj_watch(cbj, cbj->cell[l], 2 * k);
+   cbj_watch(cbj, cbj->cell[second], 2 * k + 1);
+}
+
+/*!
+ * Une ampoule vient d'être posée sur c : déplace les surveillances des
+ * nogoods qui la contiennent. Un nogood dont il ne reste qu'une case sans
+ * ampoule la retire des candidates.
+ *
+ * \return 1 si un nogood est violé ou si un retrait rend la branche morte.
+ */
+static int cbj_bulb_on(lu_cbj *cbj, const lu_puzzle *p, unsigned int c)
+{
+   lu_cover *cover = cbj->cover;
+   int *lits = cbj->lits.array;
+   int *link = &cbj->head[cover->rank[c]];
+   int node, k, j, other;
+   unsigned int base, len, i;
+
+   while ((node = *link) >= 0) {
+      k = node >> 1;
+      j = node & 1;
+      base = cbj->first.array[k];
+      len = lits[base];
+      other = lits[base + 2 - j];
+
+      // une autre case sans ampoule prend la surveillance
+      for (i = 3; i <= len && cbj_is_bulb(cover, lits[base + i]); ++i) {
+      }
+      if (i <= len) {
+         lits[base + 1 + j] = lits[base + i];
+         lits[base + i] = c;
+         *link = cbj->next.array[node];
+         cbj_watch(cbj, lits[base + 1 + j], node);
+         continue;
+      }
+
+      if (cbj_is_bulb(cover, other)) {
+         if (cover->conflict == COVER_NONE) {
+            cover->conflict = CBJ_NOGOOD(cover->walls, k);
+         }
+         return 1;
+      }
+      if (cover_forbid(cover, p, other, CBJ_NOGOOD(cover->walls, k))) {
+         return 1;
+      }
+      link = &cbj->next.array[node];
+   }
+
+   return 0;
+}
+
+/*!
+ * Défait la décision du niveau l.
+ */
+static void cbj_pop(lu_cbj *cbj, int l)
+{
+   lu_cover *cover = cbj->cover;
+   int c = cbj->cell[l];
+
+   if (cbj->skip[l]) {
+      cover_unskip(cover);
+   } else {
+      cover_bulb_off(cover, c);
+      walls_bulb_off(cover->walls, c);
+   }
+   cbj->level[cover->rank[c]] = -1;
+   cbj->pool.size = cbj->cs_first[l];
+}
+
+static int cbj_compare_int(const void *a, const void *b)
+{
+   return *(const int *) a - *(const int *) b;
+}
+
+void cbj_solve(lu_cbj *cbj, const lu_puzzle *p, position_array pa_empty, position_array pa_impossible, int_array *solutions, unsigned int *sol_id)
+{
+   lu_cover *cover = cbj->cover;
+   lu_walls *walls = cover->walls;
+   unsigned int i, sol_id_local = 0;
+   int c, l, depth = 0, all, dead = cover_init(cover, p, pa_empty, pa_impossible);
+   int_array current = new_int_array_with_size(pa_empty.size + 1);
+
+   *solutions = new_int_array();
+   for (;;) {
+      if (!dead) {
+         c = cover_pick(cover, p, pa_empty, pa_impossible);
+         if (c >= 0) {
+            l = depth++;
+            cbj->cell[l] = c;
+            cbj->skip[l] = 0;
+            cbj->learned[l] = 0;
+            cbj->start[l] = sol_id_local;
+            cbj->cs_first[l] = cbj->pool.size;
+            cbj->level[cover->rank[c]] = l;
+            walls_bulb_on(walls, c);
+            dead = cover_bulb_on(cover, p, c) || cbj_bulb_on(cbj, p, c);
+            continue;
+         }
+
+         //Toutes les cases sont éclairées
+         if (walls->unsat == 0) {
+            current.size = 0;
+            for (l = 0; l < depth; ++l) {
+               if (!cbj->skip[l]) {
+                  add_to_int_array(&current, cover->rank[cbj->cell[l]]);
+               }
+            }
+            qsort(current.array, current.size, sizeof(int), cbj_compare_int);
+            for (i = 0; i < current.size; ++i) {
+               add_to_int_array(solutions, current.array[i]);
+            }
+            add_to_int_array(solutions, -1);
+            ++sol_id_local;
+         }
+         all = 1;
+      } else {
+         all = !cbj_analyze(cbj, p);
+      }
+
+      // retour arrière : chronologique après une solution, sinon jusqu'au
+      // niveau le plus profond de l'ensemble de conflit
+      dead = 1;
+      while (dead) {
+         if (all ? depth == 0 : cbj->cs.size == 0) {
+            break;
+         }
+         l = all ? depth - 1 : cbj->cs_max;
+         while (depth > l + 1) {
+            cbj_pop(cbj, --depth);
+         }
+         c = cbj->cell[l];
+         if (cbj->skip[l]) {
+            // les deux branches sont épuisées et l'une a donné des solutions
+            // (sinon le niveau aurait été remplacé par ses raisons)
+            cbj_pop(cbj, --depth);
+            all = 1;
+            continue;
+         }
+         cover_bulb_off(cover, c);
+         walls_bulb_off(walls, c);
+         if (!all && sol_id_local == cbj->start[l]) {
+            cbj_learn(cbj, l);
+         }
+         cbj->skip[l] = 1;
+         dead = cover_skip(cover, p, c);
+         if (dead) {
+            all = !cbj_analyze(cbj, p);
+         }
+      }
+      if (dead) {
+         break;
+      }
+   }
+
+   // une contradiction sans raison termine la recherche à n'importe quel niveau
+   while (depth > 0) {
+      cbj_pop(cbj, --depth);
+   }
+   add_to_int_array(solutions, -2);
+   *sol_id = sol_id_local;
+   cover_clear(cover, p, pa_empty);
+   delete_int_array(&current);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "cover.h"
+#include "lightup.h"
+#include "utils.h"
+
+/** Nombre maximum d'ampoules dans un nogood appris */
+#define CBJ_NOGOOD_MAX 32
+/** Nombre maximum de nogoods appris par classe */
+#define CBJ_NOGOODS_MAX (1 << 16)
+
+/*!
+ * \struct lu_cbj Recherche d'une classe par décisions binaires (comme
+ * solve_mcv()), avec analyse des conflits. Quand une branche meurt, les
+ * raisons des retraits notées par la couverture (ampoule qui éclaire la
+ * case, mur saturé, case écartée, nogood) donnent l'ensemble des niveaux
+ * responsables : la recherche remonte directement au plus profond d'entre
+ * eux au lieu de défaire une seule décision.
+ *
+ * Une case écartée après l'échec de sa branche ampoule a pour raison
+ * l'ensemble de conflit de cette branche ; elle n'est une vraie décision
+ * que si la branche ampoule a donné des solutions. Un ensemble de conflit
+ * qui ne contient que des ampoules est appris comme nogood : ces ampoules
+ * ne peuvent pas être posées ensemble. Un nogood est vrai pour toute la
+ * classe, il est gardé jusqu'à la fin de l'énumération et surveillé par
+ * deux de ses cases : quand toutes ses ampoules sauf une sont posées, la
+ * dernière case est retirée des candidates.
+ *
+ * Les tableaux sont indexés par niveau de décision ou par rang de la case
+ * dans pa_empty, et dimensionnés pour une classe.
+ */
+typedef struct {
+   lu_cover *cover;           /*!< couverture de la recherche */
+   unsigned int nb_cells;     /*!< cases vides de la classe */
+   int *level;                /*!< niveau de la décision prise sur chaque case, -1 sinon */
+   int *cell;                 /*!< case de chaque niveau */
+   unsigned char *skip;       /*!< 1 si la case du niveau est écartée (seconde branche) */
+   unsigned char *learned;    /*!< 1 si la branche ampoule du niveau a échoué sur un conflit */
+   unsigned int *start;       /*!< nombre de solutions au début de chaque niveau */
+   unsigned int *cs_first;    /*!< ensemble de conflit de la branche ampoule, dans pool */
+   unsigned int *cs_size;     /*!< sa taille */
+   unsigned char *mark;       /*!< niveaux déjà vus par l'analyse */
+   int_array pool;            /*!< ensembles de conflit des niveaux, empilés */
+   int_array cs;              /*!< ensemble de conflit courant (niveaux) */
+   int cs_max;                /*!< plus grand niveau de cs */
+   int_array seen;            /*!< niveaux marqués par l'analyse */
+   int_array work;            /*!< niveaux à expliquer */
+   int_array lits;            /*!< nogoods : taille puis cases, les deux premières surveillées */
+   int_array first;           /*!< début de chaque nogood dans lits */
+   int *head;                 /*!< première surveillance de chaque case (par rang), -1 sinon */
+   int_array next;            /*!< surveillance suivante : 2k et 2k + 1 pour le nogood k */
+} lu_cbj;
+
+/*!
+ * Alloue la recherche avec apprentissage pour une classe.
+ *
+ * \param cover La couverture du puzzle.
+ * \param nb_cells Nombre de cases vides de la classe.
+ * \return La recherche, sans nogood.
+ */
+lu_cbj *cbj_new(lu_cover *cover, unsigned int nb_cells);
+
+/*!
+ * Libère la mémoire utilisée par la recherche.
+ *
+ * \param cbj La recherche à libérer.
+ */
+void cbj_destroy(lu_cbj *cbj);
+
+/*!
+ * Équivalent de solve_mcv() avec retour arrière non chronologique et
+ * nogoods appris. Produit les mêmes solutions, triées par index.
+ *
+ * \param cbj La recherche.
+ * \param p Le puzzle.
+ * \param pa_empty Cases vides de la classe.
+ * \param pa_impossible Cases impossibles de la classe.
+ * \param[out] solutions Solutions de la classe (index dans pa_empty, -1 entre
+ * deux solutions, -2 à la fin).
+ * \param[out] sol_id Nombre de solutions.
+ */
+void cbj_solve(lu_cbj *cbj, const lu_puzzle *p, position_array pa_empty, position_array pa_impossible, int_array *solutions, unsigned int *sol_id);
@@ -0,0 +1,295 @@
+#include "count.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define COUNT_TABLE_INITIAL_SIZE 64
+
+void count_table_init(lu_count_table *t, unsigned int key_len)
+{
+   t->key_len = key_len;
+   t->size = 0;
+   t->max_size = COUNT_TABLE_INITIAL_SIZE;
+   t->nb_buckets = COUNT_TABLE_INITIAL_SIZE;
+   t->keys = (unsigned char *) malloc(t->max_size * (key_len + 1));
+   t->buckets = (int *) malloc(sizeof(int) * t->nb_buckets);
+   t->next = (int *) malloc(sizeof(int) * t->max_size);
+   memset(t->buckets, -1, sizeof(int) * t->nb_buckets);
+}
+
+void count_table_delete(lu_count_table *t)
+{
+   free(t->keys);
+   free(t->buckets);
+   free(t->next);
+}
+
+static __inline unsigned int count_hash(const unsigned char *key, unsigned int len)
+{
+   unsigned int i, h = 2166136261u;
+
+   for (i = 0; i < len; ++i) {
+      h = (h ^ key[i]) * 16777619u;
+   }
+   return h;
+}
+
+unsigned int count_table_insert(lu_count_table *t, const unsigned char *key)
+{
+   unsigned int b = count_hash(key, t->key_len) & (t->nb_buckets - 1), i;
+   int n;
+
+   for (n = t->buckets[b]; n >= 0; n = t->next[n]) {
+      if (memcmp(count_table_key(t, n), key, t->key_len) == 0) {
+         return n;
+      }
+   }
+
+   if (t->size == t->max_size) {
+      t->max_size *= 2;
+      t->keys = (unsigned char *) realloc(t->keys, t->max_size * (t->key_len + 1));
+      t->next = (int *) realloc(t->next, sizeof(int) * t->max_size);
+      t->nb_buckets = t->max_size;
+      t->buckets = (int *) realloc(t->buckets, sizeof(int) * t->nb_buckets);
+      memset(t->buckets, -1, sizeof(int) * t->nb_buckets);
+      for (i = 0; i < t->size; ++i) {
+         b = count_hash(count_table_key(t, i), t->key_len) & (t->nb_buckets - 1);
+         t->next[i] = t->buckets[b];
+         t->buckets[b] = i;
+      }
+      b = count_hash(key, t->key_len) & (t->nb_buckets - 1);
+   }
+
+   memcpy(count_table_key(t, t->size), key, t->key_len);
+   t->next[t->size] = t->buckets[b];
+   t->buckets[b] = t->size;
+
+   return t->size++;
+}
+
+/*!
+ * Murs partagés voisins de la case c.
+ */
+static __inline int count_shared_wall(const lu_walls *walls, unsigned int c, unsigned int i)
+{
+   int w = walls->adj[4 * c + i];
+   return (w >= 0 && walls->owner[w] == WALL_SHARED) ? w : -1;
+}
+
+lu_count *count_new(const lu_puzzle *p, const lu_walls *walls, const position_array *classes, unsigned int nb_classes)
+{
+   lu_count *cnt = (lu_count *) malloc(sizeof(*cnt));
+   unsigned int cls, index, i, c, w;
+   int dead = 0;
+
+   cnt->p = p;
+   cnt->walls = walls;
+   cnt->classes = classes;
+   cnt->wall_last = (int *) malloc(sizeof(int) * (walls->nb_walls + 1));
+   cnt->open_pos = (int *) malloc(sizeof(int) * (walls->nb_walls + 1));
+   cnt->sig_pos = (int *) malloc(sizeof(int) * (walls->nb_walls + 1));
+   memset(cnt->wall_last, -1, sizeof(int) * (walls->nb_walls + 1));
+   memset(cnt->open_pos, -1, sizeof(int) * (walls->nb_walls + 1));
+   memset(cnt->sig_pos, -1, sizeof(int) * (walls->nb_walls + 1));
+
+   for (cls = 0; cls < nb_classes; ++cls) {
+      for (index = 0; index < classes[cls].size; ++index) {
+         c = classes[cls].array[index].line * p->width + classes[cls].array[index].column;
+         for (i = 0; i < 4; ++i) {
+            if (count_shared_wall(walls, c, i) >= 0) {
+               cnt->wall_last[walls->adj[4 * c + i]] = cls;
+            }
+         }
+      }
+   }
+
+   // les murs sans voisin vide ne changeront plus
+   for (w = 0; w < walls->nb_walls; ++w) {
+      dead |= walls->owner[w] == WALL_FIXED && walls->bulbs[w] != walls->need[w];
+   }
+
+   cnt->cls = -1;
+   cnt->class_walls = new_int_array();
+   cnt->open = new_int_array();
+   cnt->sig = (unsigned char *) malloc(sizeof(unsigned char) * 4 * (walls->nb_walls + 1));
+   count_table_init(&cnt->sigs, 0);
+   cnt->sig_count = (unsigned long long *) malloc(sizeof(unsigned long long) * cnt->sigs.max_size);
+
+   count_table_init(&cnt->states, 0);
+   cnt->value = (lu_bigint *) malloc(sizeof(lu_bigint) * cnt->states.max_size);
+   if (!dead) {
+      count_table_insert(&cnt->states, cnt->sig);
+      cnt->value[0] = bigint_new(1);
+   }
+
+   return cnt;
+}
+
+void count_destroy(lu_count *cnt)
+{
+   unsigned int i;
+
+   if (cnt != NULL) {
+      for (i = 0; i < cnt->states.size; ++i) {
+         bigint_delete(&cnt->value[i]);
+      }
+      free(cnt->value);
+      count_table_delete(&cnt->states);
+      count_table_delete(&cnt->sigs);
+      free(cnt->sig_count);
+      free(cnt->sig);
+      delete_int_array(&cnt->open);
+      delete_int_array(&cnt->class_walls);
+      free(cnt->wall_last);
+      free(cnt->open_pos);
+      free(cnt->sig_pos);
+      free(cnt);
+   }
+}
+
+void count_begin_class(lu_count *cnt, unsigned int cls)
+{
+   const position_array *pa = &cnt->classes[cls];
+   unsigned int index, i, c;
+   int w;
+
+   cnt->cls = cls;
+   cnt->class_walls.size = 0;
+   for (index = 0; index < pa->size; ++index) {
+      c = pa->array[index].line * cnt->p->width + pa->array[index].column;
+      for (i = 0; i < 4; ++i) {
+         w = count_shared_wall(cnt->walls, c, i);
+         if (w >= 0 && cnt->sig_pos[w] < 0) {
+            cnt->sig_pos[w] = cnt->class_walls.size;
+            add_to_int_array(&cnt->class_walls, w);
+         }
+      }
+   }
+
+   count_table_delete(&cnt->sigs);
+   count_table_init(&cnt->sigs, cnt->class_walls.size);
+   cnt->sig_count = (unsigned long long *) realloc(cnt->sig_count, sizeof(unsigned long long) * cnt->sigs.max_size);
+}
+
+void count_add_solution(lu_count *cnt, const int *solution)
+{
+   const position_array *pa = &cnt->classes[cnt->cls];
+   unsigned int i, c, n;
+   int w;
+
+   memset(cnt->sig, 0, cnt->class_walls.size);
+   for (; *solution != -1; ++solution) {
+      c = pa->array[*solution].line * cnt->p->width + pa->array[*solution].column;
+      for (i = 0; i < 4; ++i) {
+         w = count_shared_wall(cnt->walls, c, i);
+         if (w >= 0) {
+            ++cnt->sig[cnt->sig_pos[w]];
+         }
+      }
+   }
+
+   n = cnt->sigs.size;
+   i = count_table_insert(&cnt->sigs, cnt->sig);
+   if (i == n) {
+      cnt->sig_count = (unsigned long long *) realloc(cnt->sig_count, sizeof(unsigned long long) * cnt->sigs.max_size);
+      cnt->sig_count[i] = 0;
+   }
+   ++cnt->sig_count[i];
+}
+
+void count_end_class(lu_count *cnt)
+{
+   const lu_walls *walls = cnt->walls;
+   // murs touchés par l'étape : ouverts avant ou voisins de la classe
+   int_array touch = new_int_array_with_size(cnt->open.size + cnt->class_walls.size + 1);
+   int_array next_open = new_int_array_with_size(cnt->open.size + cnt->class_walls.size + 1);
+   int *new_pos = (int *) malloc(sizeof(int) * (touch.max_size + 1));
+   unsigned char *key = (unsigned char *) malloc(touch.max_size + 1);
+   lu_count_table states;
+   lu_bigint *value;
+   unsigned int i, k, s, g, n, val;
+   int w, ok;
+
+   for (i = 0; i < cnt->open.size; ++i) {
+      add_to_int_array(&touch, cnt->open.array[i]);
+   }
+   for (i = 0; i < cnt->class_walls.size; ++i) {
+      if (cnt->open_pos[cnt->class_walls.array[i]] < 0) {
+         add_to_int_array(&touch, cnt->class_walls.array[i]);
+      }
+   }
+   for (i = 0; i < touch.size; ++i) {
+      w = touch.array[i];
+      new_pos[i] = -1;
+      if (cnt->wall_last[w] != cnt->cls) {
+         new_pos[i] = next_open.size;
+         add_to_int_array(&next_open, w);
+      }
+   }
+
+   count_table_init(&states, next_open.size);
+   value = (lu_bigint *) malloc(sizeof(lu_bigint) * states.max_size);
+   for (s = 0; s < cnt->states.size; ++s) {
+      const unsigned char *old = count_table_key(&cnt->states, s);
+      for (g = 0; g < cnt->sigs.size; ++g) {
+         const unsigned char *sig = count_table_key(&cnt->sigs, g);
+         ok = 1;
+         for (i = 0; i < touch.size && ok; ++i) {
+            w = touch.array[i];
+            val = (cnt->open_pos[w] >= 0 ? old[cnt->open_pos[w]] : 0) + (cnt->sig_pos[w] >= 0 ? sig[cnt->sig_pos[w]] : 0);
+            ok = (int) val <= walls->need[w] - walls->bulbs[w];
+            if (new_pos[i] >= 0) {
+               key[new_pos[i]] = val;
+            } else {
+               // dernière classe du mur : il doit être satisfait
+               ok = ok && (int) val == walls->need[w] - walls->bulbs[w];
+            }
+         }
+         if (!ok) {
+            continue;
+         }
+         n = states.size;
+         k = count_table_insert(&states, key);
+         if (k == n) {
+            value = (lu_bigint *) realloc(value, sizeof(lu_bigint) * states.max_size);
+            value[k] = bigint_new(0);
+         }
+         bigint_add_mul(&value[k], &cnt->value[s], cnt->sig_count[g]);
+      }
+   }
+
+   for (s = 0; s < cnt->states.size; ++s) {
+      bigint_delete(&cnt->value[s]);
+   }
+   free(cnt->value);
+   count_table_delete(&cnt->states);
+   cnt->states = states;
+   cnt->value = value;
+
+   for (i = 0; i < cnt->open.size; ++i) {
+      cnt->open_pos[cnt->open.array[i]] = -1;
+   }
+   for (i = 0; i < cnt->class_walls.size; ++i) {
+      cnt->sig_pos[cnt->class_walls.array[i]] = -1;
+   }
+   delete_int_array(&cnt->open);
+   cnt->open = next_open;
+   for (i = 0; i < cnt->open.size; ++i) {
+      cnt->open_pos[cnt->open.array[i]] = i;
+   }
+
+   delete_int_array(&touch);
+   free(new_pos);
+   free(key);
+}
+
+void count_result(const lu_count *cnt, lu_bigint *result)
+{
+   unsigned int s;
+
+   // tous les murs partagés sont fermés : au plus un état, de clé vide
+   *result = bigint_new(0);
+   for (s = 0; s < cnt->states.size; ++s) {
+      bigint_add(result, &cnt->value[s]);
+   }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "bigint.h"
+#include "lightup.h"
+#include "utils.h"
+#include "walls.h"
+
+/*!
+ * \struct lu_count_table Table de hachage de clés de longueur fixe (un
+ * octet par mur) vers un index ; les valeurs sont gardées à part par
+ * l'appelant, dans des tableaux d'au moins max_size cases.
+ */
+typedef struct {
+   unsigned int key_len;   /*!< longueur des clés */
+   unsigned int size;      /*!< nombre de clés */
+   unsigned int max_size;  /*!< taille allouée */
+   unsigned int nb_buckets;/*!< nombre de listes (puissance de 2) */
+   unsigned char *keys;    /*!< clés, à la suite */
+   int *buckets;           /*!< première clé de chaque liste */
+   int *next;              /*!< clé suivante de la même liste */
+} lu_count_table;
+
+/*!
+ * Prépare une table vide pour des clés de key_len octets.
+ */
+void count_table_init(lu_count_table *t, unsigned int key_len);
+
+/*!
+ * Libère la mémoire utilisée par la table.
+ */
+void count_table_delete(lu_count_table *t);
+
+/*!
+ * Index de la clé, ajoutée si elle n'est pas encore dans la table.
+ */
+unsigned int count_table_insert(lu_count_table *t, const unsigned char *key);
+
+/*!
+ * Clé d'index i.
+ */
+static __inline unsigned char *count_table_key(const lu_count_table *t, unsigned int i)
+{
+   return t->keys + i * t->key_len;
+}
+
+/*!
+ * \struct lu_count Compte les solutions du puzzle sans énumérer le produit
+ * des classes. Seuls les murs partagés couplent les classes : une solution
+ * d'une classe est résumée par sa signature (ampoules posées autour de
+ * chacun de ses murs partagés). Les classes sont ajoutées dans l'ordre,
+ * l'état est le nombre d'ampoules autour des murs partagés ouverts (touchés
+ * par une classe déjà ajoutée et une classe à venir), associé au nombre de
+ * combinaisons qui y mènent. Un mur est vérifié puis oublié après sa
+ * dernière classe.
+ */
+typedef struct {
+   const lu_puzzle *p;           /*!< le puzzle */
+   const lu_walls *walls;        /*!< compteurs des murs (sans les ampoules des classes) */
+   const position_array *classes;/*!< cases vides de chaque classe */
+   int *wall_last;               /*!< dernière classe qui touche chaque mur partagé, -1 sinon */
+   int *open_pos;                /*!< position de chaque mur dans la clé des états, -1 sinon */
+   int *sig_pos;                 /*!< position de chaque mur dans la signature de la classe, -1 sinon */
+
+   int cls;                      /*!< classe en cours d'ajout */
+   int_array class_walls;        /*!< murs partagés de la classe en cours */
+   lu_count_table sigs;          /*!< signatures de la classe en cours */
+   unsigned long long *sig_count;/*!< nombre de solutions de chaque signature */
+   unsigned char *sig;           /*!< signature en construction */
+
+   int_array open;               /*!< murs ouverts, dans l'ordre de la clé */
+   lu_count_table states;        /*!< états */
+   lu_bigint *value;             /*!< nombre de combinaisons de chaque état */
+} lu_count;
+
+/*!
+ * Prépare le comptage : aucune classe ajoutée, un seul état (ou aucun si un
+ * mur sans voisin vide n'a pas le bon nombre d'ampoules).
+ *
+ * \param p Le puzzle.
+ * \param walls Les compteurs des murs, avec leurs propriétaires.
+ * \param classes Cases vides de chaque classe.
+ * \param nb_classes Nombre de classes.
+ */
+lu_count *count_new(const lu_puzzle *p, const lu_walls *walls, const position_array *classes, unsigned int nb_classes);
+
+/*!
+ * Libère la mémoire utilisée par le comptage.
+ */
+void count_destroy(lu_count *cnt);
+
+/*!
+ * Commence l'ajout des solutions de la classe cls (dans l'ordre des classes).
+ */
+void count_begin_class(lu_count *cnt, unsigned int cls);
+
+/*!
+ * Ajoute une solution de la classe en cours.
+ *
+ * \param solution Index dans les cases vides de la classe, terminés par -1.
+ */
+void count_add_solution(lu_count *cnt, const int *solution);
+
+/*!
+ * Combine les solutions de la classe en cours avec les états.
+ */
+void count_end_class(lu_count *cnt);
+
+/*!
+ * Nombre de solutions du puzzle, une fois toutes les classes ajoutées.
+ *
+ * \param[out] result Le nombre de solutions (à libérer par bigint_delete()).
+ */
+void count_result(const lu_count *cnt, lu_bigint *result);
@@ -0,0 +1,354 @@
+#include "cover.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+lu_cover *cover_new(const lu_segments *segs, lu_walls *walls)
+{
+   unsigned int size = segs->width * segs->height;
+
+   lu_cover *cover = (lu_cover *) malloc(sizeof(*cover));
+   cover->segs = segs;
+   cover->walls = walls;
+   cover->walls_dead = walls->dead;
+   cover->bulbs = (unsigned int *) calloc(2 * (segs->nb_segs + 1), sizeof(unsigned int));
+   cover->avail = cover->bulbs + segs->nb_segs + 1;
+   cover->cand = (unsigned char *) calloc(size, sizeof(unsigned char));
+   cover->rank = (int *) malloc(sizeof(int) * size);
+   // une case n'est retirée qu'une fois le long d'une branche
+   cover->trail = (unsigned int *) malloc(sizeof(unsigned int) * (size + 1));
+   cover->marks = (unsigned int *) malloc(sizeof(unsigned int) * (size + 1));
+   cover->size = 0;
+   cover->depth = 0;
+   cover->cause = (int *) malloc(sizeof(int) * size);
+   memset(cover->cause, 0xff, sizeof(int) * size);
+   cover->conflict = COVER_NONE;
+
+   return cover;
+}
+
+void cover_destroy(lu_cover *cover)
+{
+   if (cover != NULL) {
+      free(cover->bulbs);
+      free(cover->cand);
+      free(cover->rank);
+      free(cover->trail);
+      free(cover->marks);
+      free(cover->cause);
+      free(cover);
+   }
+}
+
+/*!
+ * Le segment s n'a plus de candidate : cherche une case sombre du segment
+ * dont l'autre segment n'en a plus non plus.
+ *
+ * \return La case trouvée, ou -1.
+ */
+static int cover_segment_dead(const lu_cover *cover, const lu_puzzle *p, unsigned int s)
+{
+   const lu_segments *segs = cover->segs;
+   const int *other = (s < segs->nb_hsegs) ? segs->vseg : segs->hseg;
+   unsigned int n, c, step = segments_step(segs, s);
+
+   if (cover->bulbs[s] > 0) {
+      return -1;
+   }
+
+   for (n = 0, c = segs->first[s]; n < segs->length[s]; ++n, c += step) {
+      if (cover->avail[other[c]] == 0 && cover_is_dark(cover, p, c)) {
+         return c;
+      }
+   }
+
+   return -1;
+}
+
+/*!
+ * Un mur voisin de idx vient de mourir : le note comme contradiction si
+ * aucune ne l'est encore.
+ */
+static void cover_wall_conflict(lu_cover *cover, unsigned int idx)
+{
+   const lu_walls *walls = cover->walls;
+   const int *adj = &walls->adj[4 * idx];
+   unsigned int i;
+
+   for (i = 0; i < 4 && adj[i] >= 0 && cover->conflict == COVER_NONE; ++i) {
+      if (walls->bulbs[adj[i]] + walls->open[adj[i]] < walls->need[adj[i]]) {
+         cover->conflict = COVER_WALL(adj[i]);
+      }
+   }
+}
+
+/*!
+ * Vérifie une case sombre isolée : ses deux segments sont sans candidate.
+ */
+static __inline int cover_cell_dead(const lu_cover *cover, const lu_puzzle *p, unsigned int c)
+{
+   return cover->avail[cover->segs->hseg[c]] == 0
+      && cover->avail[cover->segs->vseg[c]] == 0
+      && cover_is_dark(cover, p, c);
+}
+
+int cover_init(lu_cover *cover, const lu_puzzle *p, position_array pa_empty, position_array pa_impossible)
+{
+   const lu_segments *segs = cover->segs;
+   unsigned int index, c;
+   int dead;
+
+   cover->size = 0;
+   cover->depth = 0;
+   cover->walls_dead = cover->walls->dead;
+   cover->conflict = COVER_NONE;
+
+   for (index = 0; index < pa_empty.size + pa_impossible.size; ++index) {
+      position pos = (index < pa_empty.size) ? pa_empty.array[index] : pa_impossible.array[index - pa_empty.size];
+      c = pos.line * p->width + pos.column;
+      cover->bulbs[segs->hseg[c]] = cover->bulbs[segs->vseg[c]] = 0;
+      cover->avail[segs->hseg[c]] = cover->avail[segs->vseg[c]] = 0;
+      cover->cand[c] = 0;
+   }
+
+   for (index = 0; index < pa_empty.size; ++index) {
+      c = pa_empty.array[index].line * p->width + pa_empty.array[index].column;
+      cover->rank[c] = index;
+      cover->cause[c] = COVER_NONE;
+      if (walls_blocked(cover->walls, c)) {
+         walls_close(cover->walls, c);
+      } else {
+         cover->cand[c] = 1;
+         ++cover->avail[segs->hseg[c]];
+         ++cover->avail[segs->vseg[c]];
+      }
+   }
+   dead = cover->walls->dead > cover->walls_dead;
+
+   for (index = 0; index < pa_empty.size + pa_impossible.size && !dead; ++index) {
+      position pos = (index < pa_empty.size) ? pa_empty.array[index] : pa_impossible.array[index - pa_empty.size];
+      dead = cover_cell_dead(cover, p, pos.line * p->width + pos.column);
+   }
+
+   return dead;
+}
+
+void cover_clear(lu_cover *cover, const lu_puzzle *p, position_array pa_empty)
+{
+   unsigned int index, c;
+
+   for (index = 0; index < pa_empty.size; ++index) {
+      c = pa_empty.array[index].line * p->width + pa_empty.array[index].column;
+      if (!cover->cand[c]) {
+         walls_reopen(cover->walls, c);
+      }
+      cover->cand[c] = 0;
+      cover->cause[c] = COVER_NONE;
+   }
+   cover->size = 0;
+   cover->depth = 0;
+}
+
+int cover_forbid(lu_cover *cover, const lu_puzzle *p, unsigned int idx, int cause)
+{
+   unsigned int h = cover->segs->hseg[idx], v = cover->segs->vseg[idx];
+   int dark = -1;
+
+   if (!cover->cand[idx]) {
+      return 0;
+   }
+
+   cover->cand[idx] = 0;
+   cover->cause[idx] = cause;
+   cover->trail[cover->size++] = idx;
+   walls_close(cover->walls, idx);
+
+   if (--cover->avail[h] == 0) {
+      dark = cover_segment_dead(cover, p, h);
+   }
+   if (--cover->avail[v] == 0 && dark < 0) {
+      dark = cover_segment_dead(cover, p, v);
+   }
+
+   if (dark >= 0) {
+      if (cover->conflict == COVER_NONE) {
+         cover->conflict = dark;
+      }
+      return 1;
+   }
+   if (cover->walls->dead > cover->walls_dead) {
+      cover_wall_conflict(cover, idx);
+      return 1;
+   }
+   return 0;
+}
+
+int cover_remove(lu_cover *cover, const lu_puzzle *p, unsigned int idx)
+{
+   return cover_forbid(cover, p, idx, COVER_SKIPPED);
+}
+
+/*!
+ * Retire les candidates voisines des murs que l'ampoule idx vient de
+ * saturer.
+ */
+static int cover_saturated_walls(lu_cover *cover, const lu_puzzle *p, unsigned int idx)
+{
+   const lu_walls *walls = cover->walls;
+   const int *adj = &walls->adj[4 * idx];
+   unsigned int i, cell, x, y;
+   int dead = 0;
+
+   for (i = 0; i < 4 && adj[i] >= 0; ++i) {
+      if (walls->bulbs[adj[i]] < walls->need[adj[i]]) {
+         continue;
+      }
+      cell = walls->cell[adj[i]];
+      x = cell % p->width;
+      y = cell / p->width;
+      if (x >= 1) dead |= cover_forbid(cover, p, cell - 1, COVER_WALL(adj[i]));
+      if (x + 1 < p->width) dead |= cover_forbid(cover, p, cell + 1, COVER_WALL(adj[i]));
+      if (y >= 1) dead |= cover_forbid(cover, p, cell - p->width, COVER_WALL(adj[i]));
+      if (y + 1 < p->height) dead |= cover_forbid(cover, p, cell + p->width, COVER_WALL(adj[i]));
+   }
+
+   return dead;
+}
+
+int cover_bulb_on(lu_cover *cover, const lu_puzzle *p, unsigned int idx)
+{
+   const lu_segments *segs = cover->segs;
+   unsigned int i, n, c;
+   int both[2], dead = 0;
+
+   cover->marks[cover->depth++] = cover->size;
+
+   both[0] = segs->hseg[idx];
+   both[1] = segs->vseg[idx];
+   ++cover->bulbs[both[0]];
+   ++cover->bulbs[both[1]];
+
+   // toutes les cases des deux segments sont éclairées
+   for (i = 0; i < 2; ++i) {
+      unsigned int s = both[i], step = segments_step(segs, s);
+
+      for (n = 0, c = segs->first[s]; n < segs->length[s] && cover->avail[s] > 0; ++n, c += step) {
+         dead |= cover_forbid(cover, p, c, idx);
+      }
+   }
+
+   return cover_saturated_walls(cover, p, idx) || dead;
+}
+
+/*!
+ * Restaure les candidates retirées depuis la dernière décision.
+ */
+static void cover_undo(lu_cover *cover)
+{
+   const lu_segments *segs = cover->segs;
+   unsigned int mark = cover->marks[--cover->depth], c;
+
+   cover->conflict = COVER_NONE;
+   while (cover->size > mark) {
+      c = cover->trail[--cover->size];
+      cover->cand[c] = 1;
+      ++cover->avail[segs->hseg[c]];
+      ++cover->avail[segs->vseg[c]];
+      walls_reopen(cover->walls, c);
+   }
+}
+
+void cover_bulb_off(lu_cover *cover, unsigned int idx)
+{
+   cover_undo(cover);
+
+   --cover->bulbs[cover->segs->hseg[idx]];
+   --cover->bulbs[cover->segs->vseg[idx]];
+}
+
+int cover_skip(lu_cover *cover, const lu_puzzle *p, unsigned int idx)
+{
+   cover->marks[cover->depth++] = cover->size;
+
+   return cover_remove(cover, p, idx);
+}
+
+void cover_unskip(lu_cover *cover)
+{
+   cover_undo(cover);
+}
+
+/*!
+ * Première candidate du segment s.
+ */
+static int cover_first_candidate(const lu_cover *cover, unsigned int s)
+{
+   const lu_segments *segs = cover->segs;
+   unsigned int n, c, step = segments_step(segs, s);
+
+   for (n = 0, c = segs->first[s]; n < segs->length[s]; ++n, c += step) {
+      if (cover->cand[c]) {
+         return c;
+      }
+   }
+
+   return -1;
+}
+
+int cover_pick(const lu_cover *cover, const lu_puzzle *p, position_array pa_empty, position_array pa_impossible)
+{
+   const lu_segments *segs = cover->segs;
+   const lu_walls *walls = cover->walls;
+   unsigned int index, i, c, lighters, best_lighters = ~0u;
+   int dark = -1, wall_cand = -1, lighter, slack, best_slack = ~0u >> 1;
+
+   // case sombre avec le moins de candidates pour l'éclairer
+   for (index = 0; index < pa_empty.size + pa_impossible.size && best_lighters > 1; ++index) {
+      position pos = (index < pa_empty.size) ? pa_empty.array[index] : pa_impossible.array[index - pa_empty.size];
+      c = pos.line * p->width + pos.column;
+      if (!cover_is_dark(cover, p, c)) {
+         continue;
+      }
+      // la case elle-même est comptée dans ses deux segments
+      lighters = cover->avail[segs->hseg[c]] + cover->avail[segs->vseg[c]] - cover->cand[c];
+      if (lighters < best_lighters) {
+         best_lighters = lighters;
+         dark = c;
+      }
+   }
+
+   if (dark < 0) {
+      return -1;
+   }
+
+   // mur insatisfait avec le moins de marge, parmi ceux qui touchent une candidate
+   for (index = 0; index < pa_empty.size && best_slack > 0 && best_lighters > 1; ++index) {
+      c = pa_empty.array[index].line * p->width + pa_empty.array[index].column;
+      if (!cover->cand[c]) {
+         continue;
+      }
+      for (i = 0; i < 4 && walls->adj[4 * c + i] >= 0; ++i) {
+         int w = walls->adj[4 * c + i];
+         if (walls->bulbs[w] >= walls->need[w]) {
+            continue;
+         }
+         slack = walls->open[w] - (walls->need[w] - walls->bulbs[w]);
+         if (slack < best_slack) {
+            best_slack = slack;
+            wall_cand = c;
+         }
+      }
+   }
+
+   // une case sombre à n candidates donne n branches, un mur de marge m
+   // force la case au plus m + 1 fois avant de rendre la branche morte
+   if (wall_cand >= 0 && (unsigned int) best_slack + 1 < best_lighters) {
+      return wall_cand;
+   }
+
+   if (cover->cand[dark]) {
+      return dark;
+   }
+   lighter = cover_first_candidate(cover, segs->hseg[dark]);
+   return (lighter >= 0) ? lighter : cover_first_candidate(cover, segs->vseg[dark]);
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "lightup.h"
+#include "segments.h"
+#include "utils.h"
+#include "walls.h"
+
+/*!
+ * \struct lu_cover Couverture des cases sombres pendant la recherche d'une
+ * classe. Une case est candidate tant qu'elle peut encore recevoir une
+ * ampoule : elle n'est pas éclairée, aucun mur voisin n'est saturé et la
+ * recherche ne l'a pas encore écartée. Chaque segment compte ses
+ * candidates ; une case sombre dont les deux segments n'ont plus de
+ * candidate ne pourra jamais être éclairée et la branche est morte.
+ *
+ * Les murs voisins d'une candidate retirée sont prévenus (walls_close()),
+ * un mur qui n'a plus assez de candidates autour de lui rend aussi la
+ * branche morte.
+ *
+ * Les candidates retirées sont empilées sur une trace, avec un repère par
+ * décision (ampoule posée ou case écartée), pour être restaurées au retour
+ * arrière. Chaque retrait garde sa raison, et la première contradiction est
+ * notée, pour l'analyse des conflits de cbj_solve().
+ */
+/** Case retirée sans raison à expliquer (avant la recherche), ou pas de contradiction */
+#define COVER_NONE -1
+/** Case écartée par une décision (cover_skip(), cover_remove()) */
+#define COVER_SKIPPED -2
+/** Case voisine du mur w, saturé ; les valeurs au-delà du dernier mur sont libres pour cover_forbid() */
+#define COVER_WALL(w) (-3 - (int) (w))
+
+typedef struct {
+   const lu_segments *segs;   /*!< topologie des segments */
+   lu_walls *walls;           /*!< compteurs des murs */
+   unsigned int walls_dead;   /*!< murs morts au début de la classe */
+   unsigned int *bulbs;       /*!< ampoules posées dans chaque segment */
+   unsigned int *avail;       /*!< candidates restantes dans chaque segment */
+   unsigned char *cand;       /*!< 1 si la case est candidate */
+   int *rank;                 /*!< index de chaque case vide dans pa_empty */
+   unsigned int *trail;       /*!< candidates retirées, dans l'ordre */
+   unsigned int size;         /*!< nombre de cases dans la trace */
+   unsigned int *marks;       /*!< taille de la trace avant chaque décision */
+   unsigned int depth;        /*!< nombre de décisions */
+   int *cause;                /*!< raison du retrait de chaque case : ampoule qui l'éclaire (ou elle-même), COVER_SKIPPED, COVER_WALL(w)... */
+   int conflict;              /*!< première contradiction depuis la dernière restauration : case sombre, COVER_WALL(w) ou COVER_NONE */
+} lu_cover;
+
+/*!
+ * Renvoie 1 si la case doit encore être éclairée.
+ */
+static __inline int cover_is_dark(const lu_cover *cover, const lu_puzzle *p, unsigned int c)
+{
+   return (p->data[c] == lusq_empty || p->data[c] == lusq_impossible)
+      && cover->bulbs[cover->segs->hseg[c]] + cover->bulbs[cover->segs->vseg[c]] == 0;
+}
+
+/*!
+ * Alloue la couverture d'un puzzle.
+ *
+ * \param segs L'index des segments du puzzle.
+ * \param walls Les compteurs des murs du puzzle.
+ * \return La couverture, sans candidate.
+ */
+lu_cover *cover_new(const lu_segments *segs, lu_walls *walls);
+
+/*!
+ * Libère la mémoire utilisée par une couverture.
+ *
+ * \param cover La couverture à libérer.
+ */
+void cover_destroy(lu_cover *cover);
+
+/*!
+ * Prépare la couverture pour la recherche d'une classe : ses cases vides non
+ * bloquées par un mur deviennent candidates.
+ *
+ * \param cover La couverture.
+ * \param p Le puzzle.
+ * \param pa_empty Cases vides de la classe.
+ * \param pa_impossible Cases impossibles de la classe.
+ * \return 1 si la classe n'a déjà plus de solution.
+ */
+int cover_init(lu_cover *cover, const lu_puzzle *p, position_array pa_empty, position_array pa_impossible);
+
+/*!
+ * Termine la recherche d'une classe : ses cases ne sont plus candidates et
+ * les murs retrouvent leurs compteurs de départ.
+ *
+ * \param cover La couverture.
+ * \param p Le puzzle.
+ * \param pa_empty Cases vides de la classe.
+ */
+void cover_clear(lu_cover *cover, const lu_puzzle *p, position_array pa_empty);
+
+/*!
+ * Retire une candidate à la décision courante (case dépassée par la
+ * recherche). Ne fait rien si la case n'est pas candidate.
+ *
+ * \param cover La couverture.
+ * \param p Le puzzle.
+ * \param idx Index de la case.
+ * \return 1 si une case sombre ou un mur ne peut plus être satisfait.
+ */
+int cover_remove(lu_cover *cover, const lu_puzzle *p, unsigned int idx);
+
+/*!
+ * Retire une candidate à la décision courante pour une raison choisie par
+ * l'appelant (cover->cause). Ne fait rien si la case n'est pas candidate.
+ *
+ * \param cover La couverture.
+ * \param p Le puzzle.
+ * \param idx Index de la case.
+ * \param cause Raison du retrait, au-delà de COVER_WALL(nb_walls - 1).
+ * \return 1 si une case sombre ou un mur ne peut plus être satisfait.
+ */
+int cover_forbid(lu_cover *cover, const lu_puzzle *p, unsigned int idx, int cause);
+
+/*!
+ * Pose une ampoule : ses deux segments sont éclairés et n'ont plus de
+ * candidate, les voisins des murs qu'elle sature non plus. walls_bulb_on()
+ * doit avoir été appelé avant.
+ *
+ * \param cover La couverture.
+ * \param p Le puzzle.
+ * \param idx Index de la case de l'ampoule.
+ * \return 1 si une case sombre ou un mur ne peut plus être satisfait.
+ */
+int cover_bulb_on(lu_cover *cover, const lu_puzzle *p, unsigned int idx);
+
+/*!
+ * Retire la dernière ampoule posée par cover_bulb_on() et restaure les
+ * candidates retirées depuis.
+ *
+ * \param cover La couverture.
+ * \param idx Index de la case de l'ampoule.
+ */
+void cover_bulb_off(lu_cover *cover, unsigned int idx);
+
+/*!
+ * Nouvelle décision : la case ne recevra pas d'ampoule.
+ *
+ * \param cover La couverture.
+ * \param p Le puzzle.
+ * \param idx Index de la case.
+ * \return 1 si une case sombre ou un mur ne peut plus être satisfait.
+ */
+int cover_skip(lu_cover *cover, const lu_puzzle *p, unsigned int idx);
+
+/*!
+ * Annule la dernière décision prise par cover_skip().
+ *
+ * \param cover La couverture.
+ */
+void cover_unskip(lu_cover *cover);
+
+/*!
+ * Choisit la prochaine case à décider (ordre dynamique) : une candidate qui
+ * éclaire la case sombre ayant le moins de candidates, ou une candidate
+ * voisine du mur ayant le moins de marge (candidates en trop par rapport
+ * aux ampoules manquantes).
+ *
+ * \param cover La couverture.
+ * \param p Le puzzle.
+ * \param pa_empty Cases vides de la classe.
+ * \param pa_impossible Cases impossibles de la classe.
+ * \return L'index de la case choisie, ou -1 si toutes les cases sont éclairées.
+ */
+int cover_pick(const lu_cover *cover, const lu_puzzle *p, position_array pa_empty, position_array pa_impossible);
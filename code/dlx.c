@@ -0,0 +1,450 @@
+#include "dlx.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/** Types de colonnes */
+#define DLX_CELL 0         /* case à éclairer (au moins une fois) */
+#define DLX_SEG 1          /* segment (au plus une ampoule) */
+#define DLX_WALL 2         /* mur de la classe (exactement k) */
+#define DLX_WALL_OTHER 3   /* mur partagé (au plus k) */
+
+/** Opérations du journal */
+#define DLX_OP_HIDE 0      /* ligne retirée */
+#define DLX_OP_COL 1       /* colonne primaire retirée de la liste active */
+#define DLX_OP_NEED 2      /* besoin d'une colonne décrémenté */
+
+/** Résultats de dlx_select() */
+#define DLX_SOLVED -1
+#define DLX_DEAD -2
+
+lu_dlx *dlx_new(const lu_segments *segs, const lu_walls *walls)
+{
+   unsigned int size = segs->width * segs->height;
+
+   lu_dlx *dlx = (lu_dlx *) calloc(1, sizeof(*dlx));
+   dlx->segs = segs;
+   dlx->walls = walls;
+   dlx->seg_col = (int *) malloc(sizeof(int) * (segs->nb_segs + 1));
+   dlx->wall_col = (int *) malloc(sizeof(int) * (walls->nb_walls + 1));
+   dlx->cell_col = (int *) malloc(sizeof(int) * size);
+   memset(dlx->seg_col, -1, sizeof(int) * (segs->nb_segs + 1));
+   memset(dlx->wall_col, -1, sizeof(int) * (walls->nb_walls + 1));
+   memset(dlx->cell_col, -1, sizeof(int) * size);
+   dlx->undo = new_int_array();
+
+   return dlx;
+}
+
+void dlx_destroy(lu_dlx *dlx)
+{
+   if (dlx != NULL) {
+      free(dlx->seg_col);
+      free(dlx->wall_col);
+      free(dlx->cell_col);
+      delete_int_array(&dlx->undo);
+      free(dlx);
+   }
+}
+
+/*!
+ * Position d'une case de la classe : les cases vides puis les impossibles.
+ */
+static __inline unsigned int dlx_target(const lu_puzzle *p, position_array pa_empty, position_array pa_impossible, unsigned int index)
+{
+   position pos = (index < pa_empty.size) ? pa_empty.array[index] : pa_impossible.array[index - pa_empty.size];
+   return pos.line * p->width + pos.column;
+}
+
+/*!
+ * Ajoute une colonne vide.
+ */
+static int dlx_add_col(lu_dlx *dlx, int kind, int need)
+{
+   int c = dlx->nb_cols++;
+
+   dlx->kind[c] = kind;
+   dlx->need[c] = need;
+   dlx->size[c] = 0;
+   dlx->up[c] = dlx->down[c] = c;
+
+   return c;
+}
+
+/*!
+ * Ajoute le noeud n de la ligne r en bas de la colonne c.
+ */
+static void dlx_add_node(lu_dlx *dlx, int n, int r, int c)
+{
+   dlx->col[n] = c;
+   dlx->row[n] = r;
+   dlx->up[n] = dlx->up[c];
+   dlx->down[n] = c;
+   dlx->down[dlx->up[c]] = n;
+   dlx->up[c] = n;
+   ++dlx->size[c];
+}
+
+/*!
+ * Ajoute à la ligne r les cases à éclairer du segment s (sauf skip).
+ */
+static int dlx_add_segment_cells(lu_dlx *dlx, int n, int r, unsigned int s, unsigned int skip)
+{
+   const lu_segments *segs = dlx->segs;
+   unsigned int i, c, step = segments_step(segs, s);
+
+   for (i = 0, c = segs->first[s]; i < segs->length[s]; ++i, c += step) {
+      if (dlx->cell_col[c] >= 0 && c != skip) {
+         dlx_add_node(dlx, n++, r, dlx->cell_col[c]);
+      }
+   }
+
+   return n;
+}
+
+/*!
+ * Construit la matrice d'une classe.
+ */
+static void dlx_build(lu_dlx *dlx, const lu_puzzle *p, int cls, position_array pa_empty, position_array pa_impossible)
+{
+   const lu_segments *segs = dlx->segs;
+   const lu_walls *walls = dlx->walls;
+   unsigned int index, i, c, nb_targets = pa_empty.size + pa_impossible.size;
+   unsigned int max_cols, max_nodes = 0, nb_rows = 0;
+   int n, r, w, prev;
+
+   // bornes : une colonne par case, deux segments par case, 4 murs par case vide
+   max_cols = 3 * nb_targets + 4 * pa_empty.size + 1;
+   for (index = 0; index < pa_empty.size; ++index) {
+      c = dlx_target(p, pa_empty, pa_impossible, index);
+      if (!walls_blocked(walls, c)) {
+         max_nodes += segs->length[segs->hseg[c]] + segs->length[segs->vseg[c]] + 2 + 4;
+         ++nb_rows;
+      }
+   }
+
+   dlx->nb_cols = 0;
+   dlx->nb_rows = nb_rows;
+   dlx->hl = (int *) malloc(sizeof(int) * (max_cols + 1));
+   dlx->hr = (int *) malloc(sizeof(int) * (max_cols + 1));
+   dlx->kind = (int *) malloc(sizeof(int) * max_cols);
+   dlx->need = (int *) malloc(sizeof(int) * max_cols);
+   dlx->size = (int *) malloc(sizeof(int) * max_cols);
+   dlx->up = (int *) malloc(sizeof(int) * (max_cols + max_nodes));
+   dlx->down = (int *) malloc(sizeof(int) * (max_cols + max_nodes));
+   dlx->col = (int *) malloc(sizeof(int) * (max_cols + max_nodes));
+   dlx->row = (int *) malloc(sizeof(int) * (max_cols + max_nodes));
+   dlx->row_start = (int *) malloc(sizeof(int) * (nb_rows + 1));
+   dlx->row_rank = (int *) malloc(sizeof(int) * (nb_rows + 1));
+   dlx->row_hidden = (unsigned char *) calloc(nb_rows + 1, sizeof(unsigned char));
+   dlx->undo.size = 0;
+
+   // colonnes des cases à éclairer et de leurs segments
+   for (index = 0; index < nb_targets; ++index) {
+      c = dlx_target(p, pa_empty, pa_impossible, index);
+      dlx->cell_col[c] = dlx_add_col(dlx, DLX_CELL, 1);
+   }
+   for (index = 0; index < nb_targets; ++index) {
+      c = dlx_target(p, pa_empty, pa_impossible, index);
+      if (dlx->seg_col[segs->hseg[c]] < 0) {
+         dlx->seg_col[segs->hseg[c]] = dlx_add_col(dlx, DLX_SEG, 0);
+      }
+      if (dlx->seg_col[segs->vseg[c]] < 0) {
+         dlx->seg_col[segs->vseg[c]] = dlx_add_col(dlx, DLX_SEG, 0);
+      }
+   }
+
+   // murs voisins des cases vides (même bloquées : un mur sans ligne est
+   // une colonne vide qui rend la classe impossible)
+   for (index = 0; index < pa_empty.size; ++index) {
+      c = dlx_target(p, pa_empty, pa_impossible, index);
+      for (i = 0; i < 4 && (w = walls->adj[4 * c + i]) >= 0; ++i) {
+         if (dlx->wall_col[w] < 0) {
+            dlx->wall_col[w] = dlx_add_col(dlx, (walls->owner[w] == cls) ? DLX_WALL : DLX_WALL_OTHER,
+                  walls->need[w] - walls->bulbs[w]);
+         }
+      }
+   }
+
+   // lignes
+   n = dlx->nb_cols;
+   r = 0;
+   for (index = 0; index < pa_empty.size; ++index) {
+      c = dlx_target(p, pa_empty, pa_impossible, index);
+      if (walls_blocked(walls, c)) {
+         continue;
+      }
+      dlx->row_start[r] = n;
+      dlx->row_rank[r] = index;
+      dlx_add_node(dlx, n++, r, dlx->seg_col[segs->hseg[c]]);
+      dlx_add_node(dlx, n++, r, dlx->seg_col[segs->vseg[c]]);
+      for (i = 0; i < 4 && (w = walls->adj[4 * c + i]) >= 0; ++i) {
+         dlx_add_node(dlx, n++, r, dlx->wall_col[w]);
+      }
+      n = dlx_add_segment_cells(dlx, n, r, segs->hseg[c], ~0u);
+      n = dlx_add_segment_cells(dlx, n, r, segs->vseg[c], c);
+      ++r;
+   }
+   dlx->row_start[r] = n;
+
+   // liste des colonnes primaires actives, racine en nb_cols
+   prev = dlx->nb_cols;
+   for (index = 0; index < dlx->nb_cols; ++index) {
+      if (dlx->kind[index] == DLX_CELL || (dlx->kind[index] == DLX_WALL && dlx->need[index] > 0)) {
+         dlx->hr[prev] = index;
+         dlx->hl[index] = prev;
+         prev = index;
+      }
+   }
+   dlx->hr[prev] = dlx->nb_cols;
+   dlx->hl[dlx->nb_cols] = prev;
+}
+
+/*!
+ * Libère la matrice d'une classe et remet les tables de correspondance à -1.
+ */
+static void dlx_release(lu_dlx *dlx, const lu_puzzle *p, position_array pa_empty, position_array pa_impossible)
+{
+   const lu_segments *segs = dlx->segs;
+   unsigned int index, i, c;
+   int w;
+
+   for (index = 0; index < pa_empty.size + pa_impossible.size; ++index) {
+      c = dlx_target(p, pa_empty, pa_impossible, index);
+      dlx->cell_col[c] = -1;
+      dlx->seg_col[segs->hseg[c]] = -1;
+      dlx->seg_col[segs->vseg[c]] = -1;
+      if (index < pa_empty.size) {
+         for (i = 0; i < 4 && (w = dlx->walls->adj[4 * c + i]) >= 0; ++i) {
+            dlx->wall_col[w] = -1;
+         }
+      }
+   }
+
+   free(dlx->hl);
+   free(dlx->hr);
+   free(dlx->kind);
+   free(dlx->need);
+   free(dlx->size);
+   free(dlx->up);
+   free(dlx->down);
+   free(dlx->col);
+   free(dlx->row);
+   free(dlx->row_start);
+   free(dlx->row_rank);
+   free(dlx->row_hidden);
+}
+
+static __inline void dlx_log(lu_dlx *dlx, int op, int arg)
+{
+   add_to_int_array(&dlx->undo, op);
+   add_to_int_array(&dlx->undo, arg);
+}
+
+/*!
+ * Retire une ligne de toutes ses colonnes.
+ */
+static void dlx_hide_row(lu_dlx *dlx, int r)
+{
+   int n;
+
+   if (dlx->row_hidden[r]) {
+      return;
+   }
+   dlx->row_hidden[r] = 1;
+   for (n = dlx->row_start[r]; n < dlx->row_start[r + 1]; ++n) {
+      dlx->down[dlx->up[n]] = dlx->down[n];
+      dlx->up[dlx->down[n]] = dlx->up[n];
+      --dlx->size[dlx->col[n]];
+   }
+   dlx_log(dlx, DLX_OP_HIDE, r);
+}
+
+/*!
+ * Retire toutes les lignes visibles d'une colonne.
+ */
+static void dlx_hide_col_rows(lu_dlx *dlx, int c)
+{
+   int x;
+
+   // un noeud retiré garde ses propres liens, on peut continuer à partir de lui
+   for (x = dlx->down[c]; x != c; x = dlx->down[x]) {
+      dlx_hide_row(dlx, dlx->row[x]);
+   }
+}
+
+/*!
+ * Retire une colonne primaire de la liste active.
+ */
+static void dlx_deactivate(lu_dlx *dlx, int c)
+{
+   dlx->hr[dlx->hl[c]] = dlx->hr[c];
+   dlx->hl[dlx->hr[c]] = dlx->hl[c];
+   dlx_log(dlx, DLX_OP_COL, c);
+}
+
+/*!
+ * Choisit la ligne r : ampoule sur la case correspondante.
+ */
+static void dlx_choose(lu_dlx *dlx, int r)
+{
+   int n, c;
+
+   for (n = dlx->row_start[r]; n < dlx->row_start[r + 1]; ++n) {
+      c = dlx->col[n];
+      switch (dlx->kind[c]) {
+      case DLX_CELL:
+         if (dlx->need[c] > 0) {
+            --dlx->need[c];
+            dlx_log(dlx, DLX_OP_NEED, c);
+            dlx_deactivate(dlx, c);
+         }
+         break;
+      case DLX_SEG:
+         dlx_hide_col_rows(dlx, c);
+         break;
+      default:
+         --dlx->need[c];
+         dlx_log(dlx, DLX_OP_NEED, c);
+         if (dlx->need[c] == 0) {
+            dlx_hide_col_rows(dlx, c);
+            if (dlx->kind[c] == DLX_WALL) {
+               dlx_deactivate(dlx, c);
+            }
+         }
+         break;
+      }
+   }
+   dlx_hide_row(dlx, r);
+}
+
+/*!
+ * Annule les opérations du journal jusqu'à la taille mark.
+ */
+static void dlx_undo(lu_dlx *dlx, unsigned int mark)
+{
+   int op, arg, n;
+
+   while (dlx->undo.size > mark) {
+      arg = dlx->undo.array[--dlx->undo.size];
+      op = dlx->undo.array[--dlx->undo.size];
+      switch (op) {
+      case DLX_OP_HIDE:
+         for (n = dlx->row_start[arg + 1] - 1; n >= dlx->row_start[arg]; --n) {
+            dlx->down[dlx->up[n]] = n;
+            dlx->up[dlx->down[n]] = n;
+            ++dlx->size[dlx->col[n]];
+         }
+         dlx->row_hidden[arg] = 0;
+         break;
+      case DLX_OP_COL:
+         dlx->hr[dlx->hl[arg]] = arg;
+         dlx->hl[dlx->hr[arg]] = arg;
+         break;
+      default:
+         ++dlx->need[arg];
+         break;
+      }
+   }
+}
+
+/*!
+ * Choisit la colonne primaire active qui a le moins de lignes possibles.
+ *
+ * \return La colonne, DLX_SOLVED s'il n'y en a plus ou DLX_DEAD si une
+ * colonne ne peut plus être satisfaite.
+ */
+static int dlx_select(const lu_dlx *dlx)
+{
+   int root = dlx->nb_cols, c, best = DLX_SOLVED, options, best_options = ~0u >> 1;
+
+   for (c = dlx->hr[root]; c != root; c = dlx->hr[c]) {
+      // un mur à qui il manque k ampoules parmi m lignes : la première
+      // ampoule est l'une des m - k + 1 premières lignes
+      options = (dlx->kind[c] == DLX_CELL) ? dlx->size[c] : dlx->size[c] - dlx->need[c] + 1;
+      if (options <= 0) {
+         return DLX_DEAD;
+      }
+      if (options < best_options) {
+         best_options = options;
+         best = c;
+      }
+   }
+
+   return best;
+}
+
+static int dlx_compare_int(const void *a, const void *b)
+{
+   return *(const int *) a - *(const int *) b;
+}
+
+void dlx_solve(lu_dlx *dlx, const lu_puzzle *p, int cls, position_array pa_empty, position_array pa_impossible, int_array *solutions, unsigned int *sol_id)
+{
+   unsigned int l = 0, i, sol_id_local = 0;
+   int c, found;
+
+   dlx_build(dlx, p, cls, pa_empty, pa_impossible);
+
+   // par niveau : colonne choisie, ligne essayée et tailles du journal
+   int *level_col = (int *) malloc(sizeof(int) * (dlx->nb_rows + 1));
+   int *x = (int *) malloc(sizeof(int) * (dlx->nb_rows + 1));
+   unsigned int *col_mark = (unsigned int *) malloc(sizeof(unsigned int) * (dlx->nb_rows + 1));
+   unsigned int *row_mark = (unsigned int *) malloc(sizeof(unsigned int) * (dlx->nb_rows + 1));
+   int_array current = new_int_array_with_size(dlx->nb_rows + 1);
+
+   *solutions = new_int_array();
+   for (;;) {
+      c = dlx_select(dlx);
+      if (c == DLX_SOLVED) {
+         current.size = 0;
+         for (i = 0; i < l; ++i) {
+            add_to_int_array(&current, dlx->row_rank[dlx->row[x[i]]]);
+         }
+         qsort(current.array, current.size, sizeof(int), dlx_compare_int);
+         for (i = 0; i < current.size; ++i) {
+            add_to_int_array(solutions, current.array[i]);
+         }
+         add_to_int_array(solutions, -1);
+         ++sol_id_local;
+      }
+
+      if (c >= 0) {
+         level_col[l] = c;
+         col_mark[l] = dlx->undo.size;
+         x[l] = dlx->down[c];
+      } else {
+         // remonte jusqu'à un niveau qui a encore une ligne à essayer
+         found = 0;
+         while (l > 0 && !found) {
+            --l;
+            dlx_undo(dlx, row_mark[l]);
+            // la ligne essayée est écartée pour les branches suivantes
+            dlx_hide_row(dlx, dlx->row[x[l]]);
+            x[l] = dlx->down[x[l]];
+            if (x[l] == level_col[l]) {
+               dlx_undo(dlx, col_mark[l]);
+            } else {
+               found = 1;
+            }
+         }
+         if (!found) {
+            break;
+         }
+      }
+
+      row_mark[l] = dlx->undo.size;
+      dlx_choose(dlx, dlx->row[x[l]]);
+      ++l;
+   }
+
+   add_to_int_array(solutions, -2);
+   *sol_id = sol_id_local;
+
+   delete_int_array(&current);
+   free(level_col);
+   free(x);
+   free(col_mark);
+   free(row_mark);
+   dlx_release(dlx, p, pa_empty, pa_impossible);
+}
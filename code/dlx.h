@@ -0,0 +1,73 @@
+#pragma once
+
+#include "lightup.h"
+#include "segments.h"
+#include "utils.h"
+#include "walls.h"
+
+/*!
+ * \struct lu_dlx Moteur "dancing links" pour la recherche d'une classe. Le
+ * problème est vu comme une couverture généralisée :
+ * - une ligne par case pouvant recevoir une ampoule ;
+ * - une colonne primaire par case à éclairer, à couvrir au moins une fois ;
+ * - une colonne secondaire par segment, couverte au plus une fois ;
+ * - une colonne compteur par mur numéroté : exactement k lignes si le mur
+ *   appartient à la classe, au plus k sinon.
+ *
+ * Les liens sont stockés dans des tableaux d'index. Les lignes et colonnes
+ * retirées sont notées dans un journal et restaurées dans l'ordre inverse.
+ * Les tables de correspondance (segment, mur, case) vers colonne sont
+ * allouées une fois pour le puzzle et remises à -1 après chaque classe.
+ */
+typedef struct {
+   const lu_segments *segs;   /*!< topologie des segments */
+   const lu_walls *walls;     /*!< murs du puzzle (lus, jamais modifiés) */
+   int *seg_col;              /*!< colonne de chaque segment, -1 sinon */
+   int *wall_col;             /*!< colonne de chaque mur, -1 sinon */
+   int *cell_col;             /*!< colonne de chaque case à éclairer, -1 sinon */
+
+   unsigned int nb_cols;      /*!< nombre de colonnes de la classe */
+   unsigned int nb_rows;      /*!< nombre de lignes de la classe */
+   int *hl, *hr;              /*!< liste des colonnes primaires actives (racine nb_cols) */
+   int *kind;                 /*!< type de chaque colonne */
+   int *need;                 /*!< murs : ampoules manquantes */
+   int *size;                 /*!< nombre de lignes visibles de chaque colonne */
+   int *up, *down, *col, *row;/*!< liens verticaux, colonne et ligne de chaque noeud */
+   int *row_start;            /*!< premier noeud de chaque ligne (nb_rows + 1) */
+   int *row_rank;             /*!< index de la ligne dans pa_empty */
+   unsigned char *row_hidden; /*!< 1 si la ligne est retirée */
+   int_array undo;            /*!< journal des opérations (type, argument) */
+} lu_dlx;
+
+/*!
+ * Alloue le moteur DLX d'un puzzle.
+ *
+ * \param segs L'index des segments du puzzle.
+ * \param walls Les compteurs des murs du puzzle.
+ * \return Le moteur, sans classe chargée.
+ */
+lu_dlx *dlx_new(const lu_segments *segs, const lu_walls *walls);
+
+/*!
+ * Libère la mémoire utilisée par le moteur DLX.
+ *
+ * \param dlx Le moteur à libérer.
+ */
+void dlx_destroy(lu_dlx *dlx);
+
+/*!
+ * Équivalent de solve() : énumère les solutions d'une classe, en choisissant
+ * à chaque niveau la colonne qui a le moins de lignes possibles. Les
+ * solutions sont les mêmes que celles de solve(), triées par index, dans un
+ * autre ordre.
+ *
+ * \param dlx Le moteur.
+ * \param p Le puzzle.
+ * \param cls Numéro de la classe (propriétaire des murs, voir walls_set_owners()).
+ * \param pa_empty Cases vides de la classe.
+ * \param pa_impossible Cases impossibles de la classe.
+ * \param[out] solutions Solutions de la classe (index dans pa_empty, -1 entre
+ * deux solutions, -2 à la fin).
+ * \param[out] sol_id Nombre de solutions.
+ */
+void dlx_solve(lu_dlx *dlx, const lu_puzzle *p, int cls, position_array pa_empty, position_array pa_impossible, int_array *solutions, unsigned int *sol_id);
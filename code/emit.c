@@ -0,0 +1,84 @@
+#include "emit.h"
+
+#include <sched.h>
+#include <stdlib.h>
+
+lu_emit *emit_new(const lu_puzzle *p, lu_writer *w)
+{
+   lu_emit *e = (lu_emit *) malloc(sizeof(*e));
+
+   e->w = w;
+   e->record = sizeof(*p->data) * p->width * p->height;
+   e->size = 0;
+   e->max_size = 0;
+   e->buffer = NULL;
+   e->own = NULL;
+   e->overflow = 0;
+   e->ordered = NULL;
+   e->turn = NULL;
+   e->range = 0;
+
+   return e;
+}
+
+lu_emit *emit_new_ordered(const lu_puzzle *p, lu_writer *w, int *turn, size_t size)
+{
+   lu_emit *e = emit_new(p, NULL);
+
+   // un nombre entier de grilles
+   e->max_size = e->record * (size / e->record > 0 ? size / e->record : 1);
+   e->own = (unsigned char *) malloc(e->max_size);
+   e->buffer = e->own;
+   e->ordered = w;
+   e->turn = turn;
+
+   return e;
+}
+
+void emit_destroy(lu_emit *e)
+{
+   if (e != NULL) {
+      free(e->own);
+      free(e);
+   }
+}
+
+void emit_begin(lu_emit *e, int range)
+{
+   e->w = NULL;
+   e->size = 0;
+   e->range = range;
+}
+
+void emit_take_turn(lu_emit *e)
+{
+   int turn;
+
+   // les intervalles sont pris dans l'ordre : celui dont c'est le tour
+   // avance toujours, l'attente se termine
+   for (;;) {
+      #pragma omp atomic read
+      turn = *e->turn;
+      if (turn == e->range) {
+         break;
+      }
+      sched_yield();
+   }
+   #pragma omp flush
+
+   writer_write(e->ordered, e->buffer, e->size);
+   e->size = 0;
+   e->w = e->ordered;
+}
+
+void emit_end(lu_emit *e)
+{
+   if (e->w == NULL) {
+      emit_take_turn(e);
+   }
+   e->w = NULL;
+
+   #pragma omp flush
+   #pragma omp atomic write
+   *e->turn = e->range + 1;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <string.h>
+
+#include "lightup.h"
+#include "writer.h"
+
+/*!
+ * \struct lu_emit Écriture des grilles solutions. La grille du puzzle est
+ * tenue à jour ampoule par ampoule pendant le produit : chaque solution est
+ * une simple copie de p->data, soit dans les blocs du thread d'écriture,
+ * soit dans le tampon privé d'un thread du produit parallèle
+ * (emit_new_ordered()), soit directement dans le fichier projeté en mémoire
+ * (emit_to()).
+ *
+ * Les threads du produit parallèle écrivent leurs intervalles à tour de
+ * rôle, dans l'ordre des intervalles. Le tampon privé n'est jamais agrandi :
+ * quand il est plein, le thread attend le tour de son intervalle, vide le
+ * tampon dans le writer et écrit la suite de l'intervalle directement.
+ */
+typedef struct {
+   lu_writer *w;           /*!< thread d'écriture, NULL pour le tampon privé */
+   unsigned int record;    /*!< taille d'une grille */
+   size_t size;            /*!< octets en attente */
+   size_t max_size;        /*!< taille du tampon ou de la zone */
+   unsigned char *buffer;  /*!< grilles en attente */
+   unsigned char *own;     /*!< tampon privé alloué */
+   int overflow;           /*!< 1 si une grille n'a pas tenu dans la zone de emit_to() */
+   lu_writer *ordered;     /*!< writer partagé, écrit à tour de rôle, NULL sinon */
+   int *turn;              /*!< prochain intervalle à écrire, partagé entre les threads */
+   int range;              /*!< intervalle en cours */
+} lu_emit;
+
+/*!
+ * Prépare l'écriture des grilles de p.
+ *
+ * \param p Le puzzle (pour la taille des grilles).
+ * \param w Thread d'écriture, ou NULL : les grilles vont alors dans la zone
+ * donnée par emit_to().
+ */
+lu_emit *emit_new(const lu_puzzle *p, lu_writer *w);
+
+/*!
+ * Prépare l'écriture à tour de rôle des intervalles d'un thread du produit
+ * parallèle.
+ *
+ * \param p Le puzzle (pour la taille des grilles).
+ * \param w Le writer partagé par les threads.
+ * \param turn Prochain intervalle à écrire, partagé (0 au départ).
+ * \param size Taille du tampon privé, arrondie à au moins une grille.
+ */
+lu_emit *emit_new_ordered(const lu_puzzle *p, lu_writer *w, int *turn, size_t size);
+
+/*!
+ * Libère la mémoire utilisée.
+ */
+void emit_destroy(lu_emit *e);
+
+/*!
+ * Commence l'intervalle range : ses grilles sont gardées dans le tampon
+ * privé jusqu'à son tour.
+ */
+void emit_begin(lu_emit *e, int range);
+
+/*!
+ * Attend le tour de l'intervalle en cours et vide le tampon privé dans le
+ * writer : les grilles suivantes y sont écrites directement.
+ */
+void emit_take_turn(lu_emit *e);
+
+/*!
+ * Termine l'intervalle en cours : attend son tour si besoin, écrit ce qui
+ * reste et passe la main à l'intervalle suivant.
+ */
+void emit_end(lu_emit *e);
+
+/*!
+ * Dirige les grilles suivantes vers dest, une zone de size octets du
+ * fichier projeté en mémoire qui doit pouvoir toutes les contenir. La zone
+ * n'est jamais agrandie : une grille de trop est perdue et overflow passe
+ * à 1.
+ */
+static __inline void emit_to(lu_emit *e, unsigned char *dest, size_t size)
+{
+   e->buffer = dest;
+   e->size = 0;
+   e->max_size = size;
+   e->overflow = 0;
+}
+
+/*!
+ * Ajoute la grille p.
+ */
+static __inline void emit_grid(lu_emit *e, const lu_puzzle *p)
+{
+   if (e->w != NULL) {
+      writer_write(e->w, p->data, e->record);
+      return;
+   }
+   if (e->size + e->record > e->max_size) {
+      if (e->ordered == NULL) {
+         e->overflow = 1;
+         return;
+      }
+      emit_take_turn(e);
+      writer_write(e->w, p->data, e->record);
+      return;
+   }
+   memcpy(e->buffer + e->size, p->data, e->record);
+   e->size += e->record;
+}
@@ -0,0 +1,413 @@
+#include "frontier.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/** État d'une colonne de la frontière (2 bits) */
+#define FR_NONE 0ull    /* rien à faire dans le segment vertical */
+#define FR_PEND 1ull    /* une case sombre attend une ampoule plus bas */
+#define FR_LIT 2ull     /* le segment vertical a une ampoule */
+#define FR_HWAIT 3ull   /* la case de la ligne est sombre : segment horizontal ou vertical */
+
+/** Masque des bits de poids faible des colonnes */
+#define FR_LOW_BITS 0x5555555555555555ull
+
+lu_frontier *frontier_new(const lu_segments *segs, const lu_walls *walls)
+{
+   unsigned int size = segs->width * segs->height;
+
+   lu_frontier *fr = (lu_frontier *) calloc(1, sizeof(*fr));
+   fr->segs = segs;
+   fr->walls = walls;
+   fr->rank = (int *) malloc(sizeof(int) * size);
+   fr->wall_first = (int *) malloc(sizeof(int) * (walls->nb_walls + 1));
+   fr->wall_last = (int *) malloc(sizeof(int) * (walls->nb_walls + 1));
+   fr->wall_slot = (int *) malloc(sizeof(int) * (walls->nb_walls + 1));
+   memset(fr->rank, -1, sizeof(int) * size);
+   memset(fr->wall_first, -1, sizeof(int) * (walls->nb_walls + 1));
+
+   return fr;
+}
+
+void frontier_destroy(lu_frontier *fr)
+{
+   if (fr != NULL) {
+      free(fr->rank);
+      free(fr->wall_first);
+      free(fr->wall_last);
+      free(fr->wall_slot);
+      free(fr);
+   }
+}
+
+/*!
+ * Rectangle englobant les cases de la classe.
+ */
+static void frontier_bbox(position_array pa_empty, position_array pa_impossible, unsigned int *x0, unsigned int *y0, unsigned int *x1, unsigned int *y1)
+{
+   unsigned int index;
+
+   *x0 = *y0 = ~0u;
+   *x1 = *y1 = 0;
+   for (index = 0; index < pa_empty.size + pa_impossible.size; ++index) {
+      position pos = (index < pa_empty.size) ? pa_empty.array[index] : pa_impossible.array[index - pa_empty.size];
+      if (pos.column < *x0) *x0 = pos.column;
+      if (pos.column > *x1) *x1 = pos.column;
+      if (pos.line < *y0) *y0 = pos.line;
+      if (pos.line > *y1) *y1 = pos.line;
+   }
+}
+
+int frontier_fits(position_array pa_empty, position_array pa_impossible)
+{
+   unsigned int x0, y0, x1, y1;
+
+   frontier_bbox(pa_empty, pa_impossible, &x0, &y0, &x1, &y1);
+
+   return x1 - x0 + 1 <= FRONTIER_MAX_WIDTH || y1 - y0 + 1 <= FRONTIER_MAX_WIDTH;
+}
+
+/*!
+ * Prépare le parcours de la classe : ordre des cases, murs touchés par
+ * chaque étape et emplacement de leur compteur dans l'état.
+ *
+ * \return 0 si l'état ne tient pas sur 64 bits.
+ */
+static int frontier_build(lu_frontier *fr, const lu_puzzle *p, int cls, position_array pa_empty, position_array pa_impossible)
+{
+   const lu_walls *walls = fr->walls;
+   unsigned int x0, y0, x1, y1, lines, t, i, k, index, used = 0, nb_slots = 0;
+   int transposed, cell, w;
+
+   frontier_bbox(pa_empty, pa_impossible, &x0, &y0, &x1, &y1);
+   // les lignes sont parcourues dans le sens du grand côté
+   transposed = x1 - x0 > y1 - y0;
+   fr->width = transposed ? y1 - y0 + 1 : x1 - x0 + 1;
+   lines = transposed ? x1 - x0 + 1 : y1 - y0 + 1;
+   fr->nb_steps = fr->width * lines;
+
+   for (index = 0; index < pa_empty.size; ++index) {
+      fr->rank[pa_empty.array[index].line * p->width + pa_empty.array[index].column] = index;
+   }
+   for (index = 0; index < pa_impossible.size; ++index) {
+      fr->rank[pa_impossible.array[index].line * p->width + pa_impossible.array[index].column] = -2;
+   }
+
+   fr->step_cell = (int *) malloc(sizeof(int) * fr->nb_steps);
+   fr->step_inc = (int *) malloc(sizeof(int) * 4 * fr->nb_steps);
+   fr->inc_need = (int *) malloc(sizeof(int) * 4 * fr->nb_steps);
+   fr->step_close = (int *) malloc(sizeof(int) * 4 * fr->nb_steps);
+   fr->close_need = (int *) malloc(sizeof(int) * 4 * fr->nb_steps);
+   fr->close_exact = (unsigned char *) malloc(sizeof(unsigned char) * 4 * fr->nb_steps);
+
+   for (t = 0; t < fr->nb_steps; ++t) {
+      unsigned int line = t / fr->width, j = t % fr->width;
+      cell = transposed ? (y0 + j) * p->width + x0 + line : (y0 + line) * p->width + x0 + j;
+      fr->step_cell[t] = (fr->segs->hseg[cell] < 0) ? -1 : cell;
+      if (fr->rank[cell] < 0) {
+         continue;
+      }
+      for (i = 0; i < 4 && (w = walls->adj[4 * cell + i]) >= 0; ++i) {
+         if (fr->wall_first[w] < 0) {
+            fr->wall_first[w] = t;
+         }
+         fr->wall_last[w] = t;
+      }
+   }
+
+   // un emplacement est pris à la première étape d'un mur et libéré après
+   // la dernière
+   for (t = 0; t < fr->nb_steps; ++t) {
+      for (i = 0; i < 4; ++i) {
+         fr->step_inc[4 * t + i] = fr->step_close[4 * t + i] = -1;
+      }
+      cell = fr->step_cell[t];
+      if (cell < 0 || fr->rank[cell] < 0) {
+         continue;
+      }
+      for (i = 0; i < 4 && (w = walls->adj[4 * cell + i]) >= 0; ++i) {
+         if (fr->wall_first[w] == (int) t) {
+            for (k = 0; used & (1u << k); ++k);
+            used |= 1u << k;
+            fr->wall_slot[w] = k;
+            if (k + 1 > nb_slots) nb_slots = k + 1;
+         }
+         fr->step_inc[4 * t + i] = fr->wall_slot[w];
+         fr->inc_need[4 * t + i] = walls->need[w] - walls->bulbs[w];
+      }
+      for (i = 0, k = 0; i < 4 && (w = walls->adj[4 * cell + i]) >= 0; ++i) {
+         if (fr->wall_last[w] == (int) t) {
+            fr->step_close[4 * t + k] = fr->wall_slot[w];
+            fr->close_need[4 * t + k] = walls->need[w] - walls->bulbs[w];
+            fr->close_exact[4 * t + k] = walls->owner[w] == cls;
+            used &= ~(1u << fr->wall_slot[w]);
+            ++k;
+         }
+      }
+   }
+
+   return 2 * fr->width + 1 + 3 * nb_slots <= 64;
+}
+
+/*!
+ * Remet à zéro les tables de la classe.
+ */
+static void frontier_release(lu_frontier *fr, const lu_puzzle *p, position_array pa_empty, position_array pa_impossible)
+{
+   unsigned int index, i, c;
+
+   for (index = 0; index < pa_empty.size + pa_impossible.size; ++index) {
+      position pos = (index < pa_empty.size) ? pa_empty.array[index] : pa_impossible.array[index - pa_empty.size];
+      c = pos.line * p->width + pos.column;
+      fr->rank[c] = -1;
+      for (i = 0; index < pa_empty.size && i < 4 && fr->walls->adj[4 * c + i] >= 0; ++i) {
+         fr->wall_first[fr->walls->adj[4 * c + i]] = -1;
+      }
+   }
+
+   free(fr->step_cell);
+   free(fr->step_inc);
+   free(fr->inc_need);
+   free(fr->step_close);
+   free(fr->close_need);
+   free(fr->close_exact);
+   free(fr->states);
+   free(fr->layer);
+   free(fr->succ);
+   free(fr->count);
+   fr->states = NULL;
+   fr->layer = NULL;
+   fr->succ = NULL;
+   fr->count = NULL;
+}
+
+/*!
+ * Ferme le segment horizontal courant : sans ampoule, ses cases sombres
+ * doivent être éclairées par leur segment vertical.
+ */
+static __inline unsigned long long frontier_close_hseg(unsigned long long s, unsigned int width)
+{
+   unsigned long long hbit = 1ull << (2 * width);
+   unsigned long long wait = s & (s >> 1) & FR_LOW_BITS & (hbit - 1);
+
+   if (!(s & hbit)) {
+      s &= ~(wait << 1);
+   }
+   return s & ~hbit;
+}
+
+/*!
+ * État après l'étape t depuis l'état s, avec ou sans ampoule.
+ *
+ * \return 0 si la transition est impossible.
+ */
+static int frontier_next(const lu_frontier *fr, unsigned int t, unsigned long long s, int bulb, unsigned long long *out)
+{
+   unsigned int width = fr->width, j = t % width, i, shift;
+   unsigned long long hbit = 1ull << (2 * width), v = (s >> (2 * j)) & 3, c, wait;
+   int cell = fr->step_cell[t], slot;
+
+   if (cell < 0) {
+      // un mur ferme les deux segments
+      if (bulb || v == FR_PEND) {
+         return 0;
+      }
+      s &= ~(3ull << (2 * j));
+      s = frontier_close_hseg(s, width);
+   } else if (bulb) {
+      if (fr->rank[cell] < 0 || v == FR_LIT || (s & hbit)) {
+         return 0;
+      }
+      // les cases sombres de la ligne sont éclairées
+      wait = s & (s >> 1) & FR_LOW_BITS & (hbit - 1);
+      s &= ~(wait | (wait << 1));
+      s = (s & ~(3ull << (2 * j))) | (FR_LIT << (2 * j)) | hbit;
+      for (i = 0; i < 4 && (slot = fr->step_inc[4 * t + i]) >= 0; ++i) {
+         shift = 2 * width + 1 + 3 * slot;
+         c = ((s >> shift) & 7) + 1;
+         if ((int) c > fr->inc_need[4 * t + i]) {
+            return 0;
+         }
+         s = (s & ~(7ull << shift)) | (c << shift);
+      }
+   } else if (fr->rank[cell] != -1 && v == FR_NONE && !(s & hbit)) {
+      s |= FR_HWAIT << (2 * j);
+   }
+
+   for (i = 0; i < 4 && (slot = fr->step_close[4 * t + i]) >= 0; ++i) {
+      shift = 2 * width + 1 + 3 * slot;
+      c = (s >> shift) & 7;
+      if (fr->close_exact[4 * t + i] && (int) c != fr->close_need[4 * t + i]) {
+         return 0;
+      }
+      s &= ~(7ull << shift);
+   }
+
+   if (j == width - 1) {
+      s = frontier_close_hseg(s, width);
+      // dernière ligne : plus aucune case ne peut attendre
+      if (t == fr->nb_steps - 1 && (s & ~(s >> 1) & FR_LOW_BITS & (hbit - 1))) {
+         return 0;
+      }
+   }
+
+   *out = s;
+   return 1;
+}
+
+/*!
+ * Ajoute un état à la table, en agrandissant les tableaux si besoin.
+ */
+static void frontier_push(lu_frontier *fr, unsigned long long s)
+{
+   if (fr->nb_states == fr->max_states) {
+      fr->max_states = fr->max_states ? 2 * fr->max_states : 1024;
+      fr->states = (unsigned long long *) realloc(fr->states, sizeof(unsigned long long) * fr->max_states);
+      fr->succ = (int *) realloc(fr->succ, sizeof(int) * 2 * fr->max_states);
+   }
+   fr->states[fr->nb_states++] = s;
+}
+
+/*!
+ * Construit les états de toutes les étapes et leurs successeurs.
+ *
+ * \return 0 si le nombre d'états dépasse FRONTIER_MAX_STATES.
+ */
+static int frontier_expand(lu_frontier *fr)
+{
+   unsigned int t, i, b, h, mask, table_size = 0;
+   unsigned int *table = NULL;
+   unsigned long long s;
+
+   fr->nb_states = fr->max_states = 0;
+   fr->layer = (unsigned int *) malloc(sizeof(unsigned int) * (fr->nb_steps + 2));
+   fr->layer[0] = 0;
+   frontier_push(fr, 0);
+
+   for (t = 0; t < fr->nb_steps; ++t) {
+      fr->layer[t + 1] = fr->nb_states;
+
+      // chaque état a au plus deux successeurs
+      if (table_size < 4 * (fr->layer[t + 1] - fr->layer[t])) {
+         for (table_size = 1024; table_size < 4 * (fr->layer[t + 1] - fr->layer[t]); table_size *= 2);
+         free(table);
+         table = (unsigned int *) malloc(sizeof(unsigned int) * table_size);
+      }
+      memset(table, 0, sizeof(unsigned int) * table_size);
+      mask = table_size - 1;
+
+      for (i = fr->layer[t]; i < fr->layer[t + 1]; ++i) {
+         for (b = 0; b < 2; ++b) {
+            fr->succ[2 * i + b] = -1;
+            if (!frontier_next(fr, t, fr->states[i], b, &s)) {
+               continue;
+            }
+            for (h = (unsigned int) ((s * 0x9E3779B97F4A7C15ull) >> 40) & mask;
+                  table[h] && fr->states[table[h] - 1] != s; h = (h + 1) & mask);
+            if (!table[h]) {
+               frontier_push(fr, s);
+               table[h] = fr->nb_states;
+            }
+            fr->succ[2 * i + b] = table[h] - 1;
+         }
+      }
+
+      if (fr->nb_states > FRONTIER_MAX_STATES) {
+         free(table);
+         return 0;
+      }
+   }
+   fr->layer[fr->nb_steps + 1] = fr->nb_states;
+   free(table);
+
+   // nombre de solutions en remontant : les successeurs ont un index plus grand
+   fr->count = (unsigned long long *) malloc(sizeof(unsigned long long) * fr->nb_states);
+   for (i = fr->layer[fr->nb_steps]; i < fr->nb_states; ++i) {
+      fr->count[i] = 1;
+   }
+   for (i = fr->layer[fr->nb_steps]; i-- > 0;) {
+      fr->count[i] = 0;
+      for (b = 0; b < 2; ++b) {
+         if (fr->succ[2 * i + b] >= 0) {
+            fr->count[i] += fr->count[fr->succ[2 * i + b]];
+         }
+      }
+   }
+
+   return 1;
+}
+
+static int frontier_compare_int(const void *a, const void *b)
+{
+   return *(const int *) a - *(const int *) b;
+}
+
+int frontier_solve(lu_frontier *fr, const lu_puzzle *p, int cls, position_array pa_empty, position_array pa_impossible, int_array *solutions, unsigned int *sol_id)
+{
+   unsigned int t = 0, i, sol_id_local = 0;
+   int *state, *choice, next;
+   int_array current, sorted;
+
+   if (!frontier_build(fr, p, cls, pa_empty, pa_impossible) || !frontier_expand(fr)) {
+      frontier_release(fr, p, pa_empty, pa_impossible);
+      return 0;
+   }
+
+   // énumération : on ne suit que les successeurs qui mènent à une solution,
+   // l'ampoule d'abord (choice : 2 rien essayé, 1 ampoule, 0 sans ampoule)
+   state = (int *) malloc(sizeof(int) * (fr->nb_steps + 1));
+   choice = (int *) malloc(sizeof(int) * (fr->nb_steps + 1));
+   current = new_int_array_with_size(pa_empty.size + 1);
+   sorted = new_int_array_with_size(pa_empty.size + 1);
+   *solutions = new_int_array();
+
+   state[0] = 0;
+   choice[0] = 2;
+   while (fr->count[0] > 0) {
+      if (t == fr->nb_steps) {
+         sorted.size = current.size;
+         memcpy(sorted.array, current.array, sizeof(int) * current.size);
+         qsort(sorted.array, sorted.size, sizeof(int), frontier_compare_int);
+         for (i = 0; i < sorted.size; ++i) {
+            add_to_int_array(solutions, sorted.array[i]);
+         }
+         add_to_int_array(solutions, -1);
+         ++sol_id_local;
+         --t;
+         continue;
+      }
+
+      if (choice[t] == 1) {
+         --current.size;
+      }
+      next = -1;
+      if (choice[t] == 2 && (next = fr->succ[2 * state[t] + 1]) >= 0 && fr->count[next] > 0) {
+         choice[t] = 1;
+         add_to_int_array(&current, fr->rank[fr->step_cell[t]]);
+      } else if (choice[t] >= 1 && (next = fr->succ[2 * state[t]]) >= 0 && fr->count[next] > 0) {
+         choice[t] = 0;
+      } else {
+         next = -1;
+         choice[t] = -1;
+      }
+
+      if (next < 0) {
+         if (t == 0) break;
+         --t;
+         continue;
+      }
+      state[++t] = next;
+      choice[t] = 2;
+   }
+
+   add_to_int_array(solutions, -2);
+   *sol_id = sol_id_local;
+
+   free(state);
+   free(choice);
+   delete_int_array(&current);
+   delete_int_array(&sorted);
+   frontier_release(fr, p, pa_empty, pa_impossible);
+
+   return 1;
+}
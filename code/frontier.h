@@ -0,0 +1,94 @@
+#pragma once
+
+#include "lightup.h"
+#include "segments.h"
+#include "utils.h"
+#include "walls.h"
+
+/** Largeur maximale de la frontière (petit côté du rectangle de la classe) */
+#define FRONTIER_MAX_WIDTH 8
+/** Nombre maximal d'états de toutes les étapes, au-delà on abandonne */
+#define FRONTIER_MAX_STATES (1u << 22)
+
+/*!
+ * \struct lu_frontier Programmation dynamique sur la frontière d'une classe.
+ * Les cases du rectangle englobant la classe sont parcourues ligne par ligne
+ * dans le sens du grand côté ; l'état après chaque case résume tout ce qui
+ * compte pour la suite :
+ * - pour chaque colonne de la frontière, l'état de son segment vertical
+ *   (aucune contrainte, ampoule posée, case sombre au-dessus qui attend une
+ *   ampoule plus bas, case sombre de la ligne qui attend le segment
+ *   horizontal ou vertical) ;
+ * - un bit "le segment horizontal courant a une ampoule" ;
+ * - le nombre d'ampoules posées autour de chaque mur ouvert (dont une partie
+ *   des voisins a déjà été parcourue), dans un emplacement de 3 bits.
+ *
+ * Les états de chaque étape sont gardés avec leurs successeurs : le nombre
+ * de solutions se calcule en remontant les étapes, en temps linéaire en la
+ * longueur de la classe, et l'énumération parcourt le graphe des états en
+ * ne suivant que les branches qui mènent à une solution.
+ */
+typedef struct {
+   const lu_segments *segs;   /*!< topologie des segments */
+   const lu_walls *walls;     /*!< murs du puzzle (lus, jamais modifiés) */
+   int *rank;                 /*!< index dans pa_empty, -2 case impossible de la classe, -1 sinon */
+   int *wall_first;           /*!< première étape qui touche chaque mur, -1 sinon */
+   int *wall_last;            /*!< dernière étape qui touche chaque mur */
+   int *wall_slot;            /*!< emplacement de chaque mur dans l'état */
+
+   unsigned int width;        /*!< largeur de la frontière */
+   unsigned int nb_steps;     /*!< nombre de cases parcourues */
+   int *step_cell;            /*!< case de chaque étape, -1 pour un mur */
+   int *step_inc;             /*!< emplacements incrémentés par une ampoule (4 par étape, -1) */
+   int *inc_need;             /*!< ampoules manquantes du mur de chaque incrément */
+   int *step_close;           /*!< emplacements fermés après l'étape (4 par étape, -1) */
+   int *close_need;           /*!< ampoules manquantes du mur de chaque fermeture */
+   unsigned char *close_exact;/*!< 1 si le mur fermé appartient à la classe */
+
+   unsigned long long *states;/*!< états de toutes les étapes, à la suite */
+   unsigned int nb_states;    /*!< nombre d'états */
+   unsigned int max_states;   /*!< taille allouée */
+   unsigned int *layer;       /*!< premier état de chaque étape (nb_steps + 2) */
+   int *succ;                 /*!< successeurs sans / avec ampoule de chaque état, -1 sinon */
+   unsigned long long *count; /*!< nombre de solutions depuis chaque état */
+} lu_frontier;
+
+/*!
+ * Alloue le moteur de programmation dynamique d'un puzzle.
+ *
+ * \param segs L'index des segments du puzzle.
+ * \param walls Les compteurs des murs du puzzle.
+ * \return Le moteur, sans classe chargée.
+ */
+lu_frontier *frontier_new(const lu_segments *segs, const lu_walls *walls);
+
+/*!
+ * Libère la mémoire utilisée par le moteur.
+ *
+ * \param fr Le moteur à libérer.
+ */
+void frontier_destroy(lu_frontier *fr);
+
+/*!
+ * Renvoie 1 si le petit côté du rectangle englobant la classe est d'au plus
+ * FRONTIER_MAX_WIDTH cases.
+ */
+int frontier_fits(position_array pa_empty, position_array pa_impossible);
+
+/*!
+ * Équivalent de solve() : compte les solutions de la classe par
+ * programmation dynamique puis les énumère (triées par index) en remontant
+ * la table.
+ *
+ * \param fr Le moteur.
+ * \param p Le puzzle.
+ * \param cls Numéro de la classe (propriétaire des murs, voir walls_set_owners()).
+ * \param pa_empty Cases vides de la classe.
+ * \param pa_impossible Cases impossibles de la classe.
+ * \param[out] solutions Solutions de la classe (index dans pa_empty, -1 entre
+ * deux solutions, -2 à la fin).
+ * \param[out] sol_id Nombre de solutions.
+ * \return 0 si la frontière est trop large ou a trop d'états (rien n'est
+ * écrit, il faut utiliser un autre moteur), 1 sinon.
+ */
+int frontier_solve(lu_frontier *fr, const lu_puzzle *p, int cls, position_array pa_empty, position_array pa_impossible, int_array *solutions, unsigned int *sol_id);
@@ -0,0 +1,127 @@
+#include "gray.h"
+
+#include <stdlib.h>
+
+/*!
+ * Pose (ou enlève) les ampoules de la solution k de la classe cls.
+ */
+static __inline void gray_set(const lu_gray *g, lu_puzzle *p, unsigned int cls, unsigned int k, lu_square sq)
+{
+   const position_array *pa = &g->classes[cls];
+   const lu_bits *s = bitsol_get(&g->solutions[cls], k);
+   unsigned int w, i;
+   lu_bits bits;
+
+   for (w = 0; w < g->solutions[cls].nb_words; ++w) {
+      for (bits = s[w]; bits; bits &= bits - 1) {
+         i = 64 * w + __builtin_ctzll(bits);
+         p->data[pa->array[i].line * p->width + pa->array[i].column] = sq;
+      }
+   }
+}
+
+lu_gray *gray_new(const position_array *classes, const lu_bitsol *solutions, unsigned int nb_classes)
+{
+   lu_gray *g = (lu_gray *) malloc(sizeof(*g));
+   unsigned int cls;
+
+   g->nb_classes = nb_classes;
+   g->classes = classes;
+   g->solutions = solutions;
+   g->radix = (unsigned int *) malloc(sizeof(unsigned int) * (nb_classes + 1));
+   g->cls = (unsigned int *) malloc(sizeof(unsigned int) * (nb_classes + 1));
+   g->digit = (unsigned int *) malloc(sizeof(unsigned int) * (nb_classes + 1));
+   g->dir = (int *) malloc(sizeof(int) * (nb_classes + 1));
+   g->focus = (unsigned int *) malloc(sizeof(unsigned int) * (nb_classes + 1));
+   g->nb_digits = 0;
+
+   for (cls = 0; cls < nb_classes; ++cls) {
+      g->radix[cls] = solutions[cls].size;
+   }
+
+   // la dernière classe varie le plus vite, comme dans l'ordre lexicographique
+   for (cls = nb_classes; cls-- > 0;) {
+      if (g->radix[cls] > 1) {
+         g->cls[g->nb_digits++] = cls;
+      }
+   }
+
+   return g;
+}
+
+void gray_destroy(lu_gray *g)
+{
+   if (g != NULL) {
+      free(g->radix);
+      free(g->cls);
+      free(g->digit);
+      free(g->dir);
+      free(g->focus);
+      free(g);
+   }
+}
+
+unsigned long long gray_size(const lu_gray *g)
+{
+   unsigned long long nb = 1;
+   unsigned int cls;
+
+   for (cls = 0; cls < g->nb_classes; ++cls) {
+      nb *= g->radix[cls];
+   }
+
+   return nb;
+}
+
+unsigned long long gray_write(lu_gray *g, lu_puzzle *p, lu_emit *out)
+{
+   unsigned int cls, j, n = g->nb_digits;
+   unsigned long long nb = 0;
+
+   for (cls = 0; cls < g->nb_classes; ++cls) {
+      if (g->radix[cls] == 0) {
+         return 0;
+      }
+   }
+
+   // code de Gray réfléchi sans boucle (Knuth, algorithme 7.2.1.1H)
+   for (cls = 0; cls < g->nb_classes; ++cls) {
+      gray_set(g, p, cls, 0, lusq_lbulb);
+   }
+   for (j = 0; j <= n; ++j) {
+      g->digit[j] = 0;
+      g->dir[j] = 1;
+      g->focus[j] = j;
+   }
+
+   for (;;) {
+      emit_grid(out, p);
+      ++nb;
+
+      j = g->focus[0];
+      g->focus[0] = 0;
+      if (j == n) {
+         break;
+      }
+      cls = g->cls[j];
+      gray_set(g, p, cls, g->digit[j], lusq_empty);
+      g->digit[j] += g->dir[j];
+      gray_set(g, p, cls, g->digit[j], lusq_lbulb);
+      if (g->digit[j] == 0 || g->digit[j] == g->radix[cls] - 1) {
+         g->dir[j] = -g->dir[j];
+         g->focus[j] = g->focus[j + 1];
+         g->focus[j + 1] = j + 1;
+      }
+   }
+
+   for (j = 0; j < n; ++j) {
+      gray_set(g, p, g->cls[j], g->digit[j], lusq_empty);
+   }
+   for (cls = 0; cls < g->nb_classes; ++cls) {
+      if (g->radix[cls] == 1) {
+         gray_set(g, p, cls, 0, lusq_empty);
+      }
+   }
+
+   return nb;
+}
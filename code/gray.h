@@ -0,0 +1,52 @@
+#pragma once
+
+#include "bitsol.h"
+#include "emit.h"
+#include "lightup.h"
+#include "utils.h"
+
+/*!
+ * \struct lu_gray Produit des solutions de classes libres (aucun mur
+ * partagé) parcouru en code de Gray réfléchi à base mixte : deux grilles
+ * consécutives ne diffèrent que par la solution d'une seule classe, seules
+ * ses cases sont modifiées. Chaque thread utilise son propre parcours.
+ */
+typedef struct {
+   unsigned int nb_classes;      /*!< nombre de classes libres */
+   const position_array *classes;/*!< cases vides de chaque classe */
+   const lu_bitsol *solutions;   /*!< solutions de chaque classe */
+   unsigned int *radix;          /*!< nombre de solutions de chaque classe */
+   unsigned int nb_digits;       /*!< classes à plus d'une solution */
+   unsigned int *cls;            /*!< classe de chaque chiffre, le chiffre 0 varie le plus vite */
+   unsigned int *digit;          /*!< solution courante de chaque chiffre */
+   int *dir;                     /*!< sens de chaque chiffre (+1 ou -1) */
+   unsigned int *focus;          /*!< pointeurs de focus (parcours sans boucle) */
+} lu_gray;
+
+/*!
+ * Prépare le parcours du produit des classes.
+ *
+ * \param classes Cases vides de chaque classe.
+ * \param solutions Solutions de chaque classe.
+ * \param nb_classes Nombre de classes.
+ */
+lu_gray *gray_new(const position_array *classes, const lu_bitsol *solutions, unsigned int nb_classes);
+
+/*!
+ * Libère la mémoire utilisée par le parcours.
+ */
+void gray_destroy(lu_gray *g);
+
+/*!
+ * Écrit toutes les grilles du produit, à partir de la grille p (où aucune
+ * case des classes n'a d'ampoule). La grille est rendue dans son état
+ * initial.
+ *
+ * \return Le nombre de grilles écrites.
+ */
+unsigned long long gray_write(lu_gray *g, lu_puzzle *p, lu_emit *out);
+
+/*!
+ * Nombre de grilles du produit, sans les parcourir.
+ */
+unsigned long long gray_size(const lu_gray *g);
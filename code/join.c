@@ -0,0 +1,272 @@
+#include "join.h"
+
+#include "count.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*!
+ * Murs partagés voisins de la case c.
+ */
+static __inline int join_shared_wall(const lu_walls *walls, unsigned int c, unsigned int i)
+{
+   int w = walls->adj[4 * c + i];
+   return (w >= 0 && walls->owner[w] == WALL_SHARED) ? w : -1;
+}
+
+/*!
+ * Trouve les murs partagés de la classe et la signature de chacune de ses
+ * solutions : autour de chaque mur, le nombre de bits de la solution dans le
+ * masque des cases voisines du mur.
+ */
+static void join_index_class(lu_join_class *jc, const lu_puzzle *p, const lu_walls *walls, position_array pa, const lu_bitsol *solutions, int *wall_pos)
+{
+   lu_count_table sigs;
+   int_array cwalls = new_int_array();
+   lu_bits *masks;
+   unsigned char *key;
+   int *last;
+   unsigned int index, i, c, k, n;
+   int w;
+
+   for (index = 0; index < pa.size; ++index) {
+      c = pa.array[index].line * p->width + pa.array[index].column;
+      for (i = 0; i < 4; ++i) {
+         w = join_shared_wall(walls, c, i);
+         if (w >= 0 && wall_pos[w] < 0) {
+            wall_pos[w] = cwalls.size;
+            add_to_int_array(&cwalls, w);
+         }
+      }
+   }
+
+   jc->nb_walls = cwalls.size;
+   jc->walls = (int *) malloc(sizeof(int) * (cwalls.size + 1));
+   memcpy(jc->walls, cwalls.array, sizeof(int) * cwalls.size);
+   jc->later_min = (int *) calloc(cwalls.size + 1, sizeof(int));
+   jc->later_max = (int *) calloc(cwalls.size + 1, sizeof(int));
+   jc->nb_solutions = solutions->size;
+   jc->sig = (int *) malloc(sizeof(int) * (solutions->size + 1));
+   jc->next = (int *) malloc(sizeof(int) * (solutions->size + 1));
+
+   // sans mur partagé, toutes les solutions ont la signature vide
+   if (cwalls.size == 0) {
+      jc->nb_sigs = solutions->size > 0;
+      jc->sigs = (unsigned char *) malloc(1);
+      jc->first = (int *) malloc(sizeof(int));
+      jc->first[0] = 0;
+      for (k = 0; k < solutions->size; ++k) {
+         jc->sig[k] = 0;
+         jc->next[k] = (k + 1 < solutions->size) ? (int) k + 1 : -1;
+      }
+      delete_int_array(&cwalls);
+      return;
+   }
+
+   masks = (lu_bits *) calloc(cwalls.size * solutions->nb_words, sizeof(lu_bits));
+   for (index = 0; index < pa.size; ++index) {
+      c = pa.array[index].line * p->width + pa.array[index].column;
+      for (i = 0; i < 4; ++i) {
+         w = join_shared_wall(walls, c, i);
+         if (w >= 0) {
+            masks[wall_pos[w] * solutions->nb_words + index / 64] |= 1ULL << (index % 64);
+         }
+      }
+   }
+
+   count_table_init(&sigs, cwalls.size);
+   key = (unsigned char *) malloc(cwalls.size + 1);
+   last = (int *) malloc(sizeof(int) * sigs.max_size);
+   jc->first = (int *) malloc(sizeof(int) * sigs.max_size);
+   for (k = 0; k < solutions->size; ++k) {
+      for (i = 0; i < cwalls.size; ++i) {
+         key[i] = bitsol_count(bitsol_get(solutions, k), &masks[i * solutions->nb_words], solutions->nb_words);
+      }
+      n = sigs.size;
+      jc->sig[k] = count_table_insert(&sigs, key);
+      jc->next[k] = -1;
+      if (jc->sig[k] == (int) n) {
+         last = (int *) realloc(last, sizeof(int) * sigs.max_size);
+         jc->first = (int *) realloc(jc->first, sizeof(int) * sigs.max_size);
+         jc->first[n] = k;
+      } else {
+         jc->next[last[jc->sig[k]]] = k;
+      }
+      last[jc->sig[k]] = k;
+   }
+
+   jc->nb_sigs = sigs.size;
+   jc->sigs = (unsigned char *) malloc(sigs.size * cwalls.size + 1);
+   memcpy(jc->sigs, sigs.keys, sigs.size * cwalls.size);
+
+   for (i = 0; i < cwalls.size; ++i) {
+      wall_pos[cwalls.array[i]] = -1;
+   }
+   count_table_delete(&sigs);
+   delete_int_array(&cwalls);
+   free(masks);
+   free(key);
+   free(last);
+}
+
+lu_join *join_new(const lu_puzzle *p, const lu_walls *walls, const position_array *classes, const lu_bitsol *classes_solutions, unsigned int nb_classes)
+{
+   lu_join *j = (lu_join *) malloc(sizeof(*j));
+   int *wall_pos = (int *) malloc(sizeof(int) * (walls->nb_walls + 1));
+   int *acc_min = (int *) calloc(walls->nb_walls + 1, sizeof(int));
+   int *acc_max = (int *) calloc(walls->nb_walls + 1, sizeof(int));
+   unsigned int cls, i, g;
+   int lo, hi, v;
+
+   j->nb_classes = nb_classes;
+   j->classes = (lu_join_class *) malloc(sizeof(lu_join_class) * (nb_classes + 1));
+   j->nb_heads = 0;
+   memset(wall_pos, -1, sizeof(int) * (walls->nb_walls + 1));
+   for (cls = 0; cls < nb_classes; ++cls) {
+      join_index_class(&j->classes[cls], p, walls, classes[cls], &classes_solutions[cls], wall_pos);
+      j->classes[cls].heads = j->nb_heads;
+      j->nb_heads += j->classes[cls].nb_sigs;
+   }
+
+   // bornes des ampoules posées par les classes suivantes, de la dernière
+   // classe à la première
+   for (cls = nb_classes; cls-- > 0;) {
+      lu_join_class *jc = &j->classes[cls];
+      for (i = 0; i < jc->nb_walls; ++i) {
+         jc->later_min[i] = acc_min[jc->walls[i]];
+         jc->later_max[i] = acc_max[jc->walls[i]];
+         lo = jc->nb_sigs ? 4 : 0;
+         hi = 0;
+         for (g = 0; g < jc->nb_sigs; ++g) {
+            v = jc->sigs[g * jc->nb_walls + i];
+            lo = v < lo ? v : lo;
+            hi = v > hi ? v : hi;
+         }
+         acc_min[jc->walls[i]] += lo;
+         acc_max[jc->walls[i]] += hi;
+      }
+   }
+
+   free(wall_pos);
+   free(acc_min);
+   free(acc_max);
+   return j;
+}
+
+void join_destroy(lu_join *j)
+{
+   unsigned int cls;
+
+   if (j != NULL) {
+      for (cls = 0; cls < j->nb_classes; ++cls) {
+         lu_join_class *jc = &j->classes[cls];
+         free(jc->walls);
+         free(jc->later_min);
+         free(jc->later_max);
+         free(jc->sigs);
+         free(jc->first);
+         free(jc->sig);
+         free(jc->next);
+      }
+      free(j->classes);
+      free(j);
+   }
+}
+
+lu_join_cursor *join_cursor_new(const lu_join *j)
+{
+   lu_join_cursor *cur = (lu_join_cursor *) malloc(sizeof(*cur));
+
+   cur->head = (int *) malloc(sizeof(int) * (j->nb_heads + 1));
+   cur->ok = (unsigned char *) malloc(j->nb_heads + 1);
+   cur->pos = (int *) malloc(sizeof(int) * (j->nb_classes + 1));
+   cur->merge = (int *) malloc(sizeof(int) * (j->nb_classes + 1));
+
+   return cur;
+}
+
+void join_cursor_destroy(lu_join_cursor *cur)
+{
+   if (cur != NULL) {
+      free(cur->head);
+      free(cur->ok);
+      free(cur->pos);
+      free(cur->merge);
+      free(cur);
+   }
+}
+
+/*!
+ * Le reste de chaque mur (après la signature g) doit être atteignable par
+ * les classes suivantes.
+ */
+static __inline int join_sig_compatible(const lu_join_class *jc, const lu_walls *walls, unsigned int g)
+{
+   const unsigned char *sig = &jc->sigs[g * jc->nb_walls];
+   unsigned int i;
+   int w, rest;
+
+   for (i = 0; i < jc->nb_walls; ++i) {
+      w = jc->walls[i];
+      rest = walls->need[w] - walls->bulbs[w] - sig[i];
+      if (rest < jc->later_min[i] || rest > jc->later_max[i]) {
+         return 0;
+      }
+   }
+   return 1;
+}
+
+int join_compatible(const lu_join *j, const lu_walls *walls, unsigned int cls, int k)
+{
+   return join_sig_compatible(&j->classes[cls], walls, j->classes[cls].sig[k]);
+}
+
+void join_start(const lu_join *j, lu_join_cursor *cur, const lu_walls *walls, unsigned int cls)
+{
+   const lu_join_class *jc = &j->classes[cls];
+   unsigned char *ok = &cur->ok[jc->heads];
+   int *head = &cur->head[jc->heads];
+   unsigned int g, nb_ok = 0;
+
+   for (g = 0; g < jc->nb_sigs; ++g) {
+      ok[g] = join_sig_compatible(jc, walls, g);
+      nb_ok += ok[g];
+   }
+
+   // peu de signatures : on fusionne leurs listes, sinon on parcourt toutes
+   // les solutions en sautant les incompatibles
+   cur->merge[cls] = nb_ok <= JOIN_MERGE_MAX;
+   cur->pos[cls] = 0;
+   if (cur->merge[cls]) {
+      for (g = 0; g < jc->nb_sigs; ++g) {
+         head[g] = ok[g] ? jc->first[g] : -1;
+      }
+   }
+}
+
+int join_next(const lu_join *j, lu_join_cursor *cur, unsigned int cls)
+{
+   const lu_join_class *jc = &j->classes[cls];
+   const unsigned char *ok = &cur->ok[jc->heads];
+   int *head = &cur->head[jc->heads];
+   unsigned int g, best = 0;
+   int k = -1;
+
+   if (cur->merge[cls]) {
+      for (g = 0; g < jc->nb_sigs; ++g) {
+         if (head[g] >= 0 && (k < 0 || head[g] < k)) {
+            k = head[g];
+            best = g;
+         }
+      }
+      if (k >= 0) {
+         head[best] = jc->next[k];
+      }
+      return k;
+   }
+
+   while (cur->pos[cls] < (int) jc->nb_solutions && !ok[jc->sig[cur->pos[cls]]]) {
+      ++cur->pos[cls];
+   }
+   return cur->pos[cls] < (int) jc->nb_solutions ? cur->pos[cls]++ : -1;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "bitsol.h"
+#include "lightup.h"
+#include "utils.h"
+#include "walls.h"
+
+/** Au-delà de ce nombre de signatures compatibles, les solutions sont parcourues à la suite */
+#define JOIN_MERGE_MAX 8
+
+/*!
+ * \struct lu_join_class Solutions d'une classe indexées par leur signature :
+ * le nombre d'ampoules posées autour de chacun de ses murs partagés.
+ */
+typedef struct {
+   unsigned int nb_walls;     /*!< murs partagés voisins de la classe */
+   int *walls;                /*!< ces murs */
+   int *later_min;            /*!< ampoules que les classes suivantes posent au moins autour de chaque mur */
+   int *later_max;            /*!< ampoules que les classes suivantes posent au plus autour de chaque mur */
+   unsigned int nb_sigs;      /*!< nombre de signatures différentes */
+   unsigned char *sigs;       /*!< signatures, nb_walls octets chacune */
+   int *first;                /*!< première solution de chaque signature */
+   unsigned int nb_solutions; /*!< nombre de solutions */
+   int *sig;                  /*!< signature de chaque solution */
+   int *next;                 /*!< solution suivante de même signature, -1 sinon */
+   unsigned int heads;        /*!< position des têtes de la classe dans un curseur */
+} lu_join_class;
+
+/*!
+ * \struct lu_join Jointure des classes sur les murs partagés. Les classes
+ * sont combinées dans l'ordre ; à chaque classe, seules les signatures qui
+ * laissent à chaque mur un reste atteignable par les classes suivantes sont
+ * essayées : les combinaisons incompatibles ne sont jamais posées.
+ */
+typedef struct {
+   unsigned int nb_classes;   /*!< nombre de classes */
+   lu_join_class *classes;    /*!< index de chaque classe */
+   unsigned int nb_heads;     /*!< nombre total de signatures */
+} lu_join;
+
+/*!
+ * \struct lu_join_cursor Parcours en cours des solutions compatibles de
+ * chaque classe (un curseur par thread).
+ */
+typedef struct {
+   int *head;           /*!< prochaine solution de chaque signature, -1 si incompatible */
+   unsigned char *ok;   /*!< signatures compatibles */
+   int *pos;            /*!< prochaine solution de chaque classe, parcourue à la suite */
+   int *merge;          /*!< 1 si la classe fusionne les listes de ses signatures */
+} lu_join_cursor;
+
+/*!
+ * Indexe les solutions de chaque classe.
+ *
+ * \param p Le puzzle.
+ * \param walls Les compteurs des murs, avec leurs propriétaires.
+ * \param classes Cases vides de chaque classe.
+ * \param classes_solutions Solutions de chaque classe.
+ * \param nb_classes Nombre de classes.
+ */
+lu_join *join_new(const lu_puzzle *p, const lu_walls *walls, const position_array *classes, const lu_bitsol *classes_solutions, unsigned int nb_classes);
+
+/*!
+ * Libère la mémoire utilisée par la jointure.
+ */
+void join_destroy(lu_join *j);
+
+/*!
+ * Alloue un curseur sur la jointure.
+ */
+lu_join_cursor *join_cursor_new(const lu_join *j);
+
+/*!
+ * Libère la mémoire utilisée par le curseur.
+ */
+void join_cursor_destroy(lu_join_cursor *cur);
+
+/*!
+ * Indique si la solution k de la classe cls est compatible avec les ampoules
+ * déjà posées (les classes précédentes) et les classes suivantes.
+ */
+int join_compatible(const lu_join *j, const lu_walls *walls, unsigned int cls, int k);
+
+/*!
+ * Commence le parcours des solutions compatibles de la classe cls.
+ */
+void join_start(const lu_join *j, lu_join_cursor *cur, const lu_walls *walls, unsigned int cls);
+
+/*!
+ * Solution compatible suivante de la classe cls, dans l'ordre de la liste.
+ *
+ * \return Le numéro de la solution, -1 à la fin du parcours.
+ */
+int join_next(const lu_join *j, lu_join_cursor *cur, unsigned int cls);
@@ -82,7 +82,8 @@ FILE *puzzle_open_sol_file(const char *path, unsigned int *width, unsigned int *
 lu_puzzle *puzzle_load_next_sol(FILE *fd, const unsigned int width, const unsigned int height);
 
 /*!
- * Ouvre un fichier en écriture pour y stocker les solutions.
+ * Ouvre un fichier en écriture pour y stocker les solutions (aussi en lecture,
+ * pour que writer_map() puisse le projeter en mémoire).
  *
  * \param fname nom du fichier
  * \param width Largeur du puzzle.
@@ -140,10 +141,6 @@ lu_puzzle *puzzle_clone(const lu_puzzle *p);
  */
 __inline void puzzle_light_on(lu_puzzle *p, unsigned int x, unsigned int y);
 
-__inline void puzzle_light_on_with_bufs(lu_puzzle *p, unsigned int x, unsigned int y, char * wbuf, char * hbuf, int * empty_count);
-
-__inline void puzzle_light_off_with_bufs(lu_puzzle *p, unsigned int x, unsigned int y, char * wbuf, char * hbuf,int * empty_count);
-
 /*!
  * Remplace les cases vides par des cases "enlighted" quand elles sont
  * éclairées par une ampoule quelconque.
@@ -1,208 +1,29 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-
+#include <omp.h>
+
+#include "bigint.h"
+#include "bitboard.h"
+#include "bitsol.h"
+#include "cbj.h"
+#include "count.h"
+#include "cover.h"
+#include "dlx.h"
+#include "emit.h"
+#include "frontier.h"
+#include "gray.h"
+#include "join.h"
 #include "lightup.h"
 #include "lightupsolver.h"
+#include "propagate.h"
+#include "psearch.h"
+#include "segments.h"
+#include "split.h"
 #include "utils.h"
-
-position_array left_, right_ ,top_ ,bottom_,center_;
-
-/*!
- * Lors de la résolution, on doit savoir quelles cases sont allumées sur la
- * ligne et sur la colonne d'une ampoule. Pour stocker cette info, on maintient
- * un pool de lignes et de colonnes pour limiter les allocations pendant la
- * résolution.
- * On a besoin d'une ligne et d'une colonne par ampoule, on en alloue et 
- * affecte un de chaque par requête.
- */
-typedef struct {
-   char *wbuf;              /*!< Buffers de lignes */
-   char *hbuf;              /*!< Buffers de colonnes */
-   unsigned int width;     /*!< Largeur du puzzle à résoudre */
-   unsigned int height;    /*!< Hauteur du puzzle à résoudre */
-   unsigned int nb_used;   /*!< Nombre de couples de buffers utilisés */
-   unsigned int nb_allocs; /*!< Nombre de buffers alloués */
-} wh_bufs;
-
-/*!
- * Crée un nouveau pool de lignes et colonnes pour la résolution.
- *
- * \param width Largeur du puzzle à résoudre.
- * \param height Hauteur du puzzle à résoudre.
- * \return Un nouveau pool de buffers de lignes et colonnes pour la résolution
- * du puzzle.
- */
-wh_bufs *new_wh_bufs(unsigned int width, unsigned int height, unsigned int size) {
-   wh_bufs *res = (wh_bufs *) malloc(sizeof(*res));
-
-   res->width = width;
-   res->height = height;
-   res->nb_used = 0;
-   res->nb_allocs = (size > 0) ? size : width + height;    // estimation du nb d'ampoules
-
-   res->wbuf = (char *) malloc(sizeof(*res->wbuf) * res->nb_allocs * width);
-   res->hbuf = (char *) malloc(sizeof(*res->hbuf) * res->nb_allocs * height);
-
-   return res;
-}
-
-/*!
- * Affecte une ligne et une colonne depuis le pool de buffers.
- *
- * \param bufs Le pool de lignes et colonnes.
- * \param[out] wbuf Ligne allouée dans le pool.
- * \param[out] hbuf Colonne allouée dans le pool.
- */
-void pop_wh_buf(wh_bufs *bufs, char **wbuf, char **hbuf) {
-   // tous les buffers sont utilisés
-   if (bufs->nb_used >= bufs->nb_allocs) {
-      bufs->nb_allocs *= 2;
-
-      bufs->wbuf = (char *) realloc(
-              bufs->wbuf,
-              sizeof(*bufs->wbuf) * bufs->width * bufs->nb_allocs);
-      bufs->hbuf = (char *) realloc(
-              bufs->hbuf,
-              sizeof(*bufs->hbuf) * bufs->height * bufs->nb_allocs);
-   }
-
-   *wbuf = bufs->wbuf;
-   bufs->wbuf += bufs->width;
-   *hbuf = bufs->hbuf;
-   bufs->hbuf += bufs->height;
-   ++bufs->nb_used;
-   
-   memset(*wbuf, 0, sizeof(**wbuf) * bufs->width);
-   memset(*hbuf, 0, sizeof(**hbuf) * bufs->height);
-}
-
-void get_head_wh_buf(wh_bufs *bufs, char **wbuf, char **hbuf)
-{
-   if(bufs->nb_used == 0)
-   {
-       *wbuf = NULL;
-       *hbuf = NULL;
-   }
-   else
-   {
-       *wbuf = bufs->wbuf - bufs->width;
-       *hbuf = bufs->hbuf - bufs->height;
-   }
-}
-
-/*!
- * Libère la dernière ligne et la dernière colonne affectée dans le pool. Cette
- * ligne et cette colonne sont désormais réutilisables.
- *
- * \param bufs Le pool qui possède la dernière ligne et colonne affectées.
- */
-void release_wh_buf(wh_bufs *bufs) {
-   if (bufs->nb_used == 0) {
-      return;
-   }
-
-    bufs->wbuf = bufs->wbuf - bufs->width;
-    bufs->hbuf = bufs->hbuf - bufs->height;
-
-   --bufs->nb_used;
-}
-
-/*!
- * Libére la mémoire allouée par un pool de lignes et colonnes.
- *
- * \param bufs Le pool de buffers à libérer.
- */
-void free_wh_bufs(wh_bufs *bufs) {
-   free(bufs->wbuf - bufs->nb_used*bufs->width);
-   free(bufs->hbuf - bufs->nb_used*bufs->height);
-   free(bufs);
-}
-
-/*!
- * Vérifie si la contrainte d'adjacence imposée par la case est respectée ou
- * pas.
- *
- * \param p Le puzzle qui contient la case.
- * \param x Abscisse de la case à vérifier.
- * \param y Ordonnée de la case à vérifier.
- * \return 1 s'il y a autant ou plus d'ampoules autour de la case que ce qui 
- * est imposé par la case. Renvoie 0 si la case n'est pas une case à contrainte
- * ou si il n'y a pas assez d'ampoule autour de la case.
- */
-__inline int wall_saturated(const lu_puzzle *p, unsigned int x,
-   unsigned int y)
-{
-   unsigned int idx = y * p->width + x;
-
-   // la case ne spécifie pas de contrainte particulière
-   if ((p->data[idx] > lusq_4) || (x>=p->width) || (y>=p->height)) {
-      return 0;
-   }
-
-   // compte les ampoules autour
-   unsigned int lbcount = 0;
-   if (x >= 1) {
-      lbcount += p->data[idx - 1] == lusq_lbulb;
-   }
-   if (x < p->width - 1) {
-      lbcount += p->data[idx + 1] == lusq_lbulb;
-   }
-   if (y >= 1) {
-      lbcount += p->data[idx - p->width] == lusq_lbulb;
-   }
-   if (y < p->height - 1) {
-      lbcount += p->data[idx + p->width] == lusq_lbulb;
-   }
-
-   return lbcount >= (unsigned int) p->data[idx];
-}
-
-/*!
- * Vérifie s'il est possible de respecter la contrainte imposée par un mur,
- * c'est à dir qu'il y a déjà suffisament d'ampoules ou qu'il reste suffisament
- * de case vides autour.
- *
- * \param p Le puzzle qui contient la case à tester.
- * \param x Abscisse de la case à tester.
- * \param y Ordonnée de la case à tester.
- * \return 1 s'il reste assez de place pour placer assez d'ampoules autour de
- * la case contrainte ou si la case ne contient pas de contrainte.
- * Renvoie 0 si la contrainte ne plus assez de place autour
- * de la case pour respecter la contrainte.
- */
-__inline unsigned int wall_clear(const lu_puzzle *p, unsigned int x,
-   unsigned int y)
-{
-   unsigned int idx = y * p->width + x;
-
-   // pas une contrainte
-   if (p->data[idx] > lusq_4) {
-      return 1;
-   }
-
-   // compte les ampoules et les cases vides
-   unsigned int lbcount = 0, ecount = 0;
-   if (x >= 1) {
-      ecount += p->data[idx - 1] == lusq_empty;
-      lbcount += p->data[idx - 1] == lusq_lbulb;
-   }
-   if (x < p->width - 1) {
-      ecount += p->data[idx + 1] == lusq_empty;
-      lbcount += p->data[idx + 1] == lusq_lbulb;
-   }
-   if (y >= 1) {
-      ecount += p->data[idx - p->width] == lusq_empty;
-      lbcount += p->data[idx - p->width] == lusq_lbulb;
-   }
-   if (y < p->height - 1) {
-      ecount += p->data[idx + p->width] == lusq_empty;
-      lbcount += p->data[idx + p->width] == lusq_lbulb;
-   }
-
-   return ecount + lbcount >= (unsigned int) p->data[idx];
-}
-
+#include "walls.h"
+#include "writer.h"
+#include "zdd.h"
 
 void print_solutions(position_array pa_empty, int * solutions)
 {
@@ -233,423 +54,27 @@ void print_solution(position_array pa_empty, int * solutions)
 }
 
 
-char wall_heuristic(lu_puzzle *p,
-        position_array * pa_left_border,
-        position_array * pa_right_border,
-        position_array * pa_top_border,
-        position_array * pa_bottom_border,
-        position_array * pa_center)
+//Un mur numéroté qui a encore un voisin vide n'est pas réglé
+static int wall_open(const lu_puzzle *p, unsigned int l, unsigned int c)
 {
-    unsigned int c = 0,
-                 l = 0,
-                 count = 0,
-                 current_state = 0,
-                 index = 0;
-
-    unsigned char change = 0;
-    
-    unsigned int width = p->width;
-    unsigned int height = p->height;
+    unsigned int idx = l * p->width + c;
 
-    position_array pa_local_center = *pa_center,
-                   pa_local_left_border = *pa_left_border,
-                   pa_local_right_border = *pa_right_border,
-                   pa_local_top_border = *pa_top_border,
-                   pa_local_bottom_border = *pa_bottom_border;
-
-    //COINS
-    //Coin haut gauche
-    current_state = p->data[0];
-    if(current_state == lusq_0)
-    {
-        if(p->data[1] == lusq_empty)
-        {
-            p->data[1] = lusq_impossible;
-            change = 1;
-        }
-        if(p->data[width] == lusq_empty)
-        {
-            p->data[width] = lusq_impossible;
-            change = 1;
-        }
-    }
-    else if(current_state <= lusq_2)
-    {
-        count =
-            (p->data[1] == lusq_empty) +
-            (p->data[width] == lusq_empty) +
-            (p->data[1] == lusq_lbulb) +
-            (p->data[width] == lusq_lbulb);
-        if(count == current_state)
-        {
-            if(p->data[1] == lusq_empty)
-            {
-                puzzle_light_on(p,1,0);
-                change = 1;
-            }
-            if(p->data[width] == lusq_empty)
-            {
-                puzzle_light_on(p,0,1);
-                change = 1;
-            }
-        }
-    }
-    //Coin haut droit
-    current_state = p->data[width-1];
-    if(current_state == lusq_0)
-    {
-        if(p->data[width-2] == lusq_empty)
-        {
-            p->data[width-2] = lusq_impossible;
-            change = 1;
-        }
-        if(p->data[2*width - 1] == lusq_empty)
-        {
-            p->data[2*width - 1] = lusq_impossible;
-            change = 1;
-        }
-    }
-    else if(current_state <= lusq_2)
-    {
-        count =
-            (p->data[width-2] == lusq_empty) +
-            (p->data[2*width - 1] == lusq_empty) +
-            (p->data[width-2] == lusq_lbulb) +
-            (p->data[2*width - 1] == lusq_lbulb);
-        if(count == current_state)
-        {
-            if(p->data[width-2] == lusq_empty) 
-            {
-                puzzle_light_on(p,width-2,0);
-                change = 1;
-            }
-            if(p->data[2*width - 1] == lusq_empty)
-            {
-                puzzle_light_on(p,width-1,1);
-                change = 1;
-            }
-        }
-    }
-    //Coin bas gauche
-    current_state = p->data[width*(height-1)];
-    if(current_state == lusq_0)
-    {
-        if(p->data[width*(height-2)] == lusq_empty)
-        {
-            p->data[width*(height-2)] = lusq_impossible;
-            change = 1;
-        }
-        if(p->data[width*(height-1) + 1] == lusq_empty)
-        {
-            p->data[width*(height-1) + 1] = lusq_impossible;
-            change = 1;
-        }
-    }
-    else if(current_state <= lusq_2)
-    {
-        count =
-            (p->data[width*(height-2)] == lusq_empty) +
-            (p->data[width*(height-1) + 1] == lusq_empty) +
-            (p->data[width*(height-2)] == lusq_lbulb) +
-            (p->data[width*(height-1) + 1] == lusq_lbulb);
-        if(count == current_state)
-        {
-            if(p->data[width*(height-2)] == lusq_empty)
-            {
-                puzzle_light_on(p,0,height-2);
-                change = 1;
-            }
-            if(p->data[width*(height-1) + 1] == lusq_empty)
-            {
-                puzzle_light_on(p,1,height-1);
-                change = 1;
-            }
-        }
-    }
-    //Coin bas droit
-    current_state = p->data[width*height - 1];
-    if(current_state == lusq_0)
-    {
-        if(p->data[width*height - 2] == lusq_empty)
-        {
-            p->data[width*height - 2] = lusq_impossible;
-            change = 1;
-        }
-        if(p->data[width*(height-1) - 1] == lusq_empty)
-        {
-            p->data[width*(height-1) - 1] = lusq_impossible;
-            change = 1;
-        }
-    }
-    else if(current_state <= lusq_2)
-    {
-        count =
-            (p->data[width*height - 2] == lusq_empty) +
-            (p->data[width*(height-1) - 1] == lusq_empty) +
-            (p->data[width*height - 2] == lusq_lbulb) +
-            (p->data[width*(height-1) - 1] == lusq_lbulb);
-        if(count == current_state)
-        {
-            if(p->data[width*height - 2] == lusq_empty)
-            {
-                puzzle_light_on(p,width-2,height-1);
-                change = 1;
-            }
-            if(p->data[width*(height-1) - 1] == lusq_empty)
-            {
-                puzzle_light_on(p,width-1,height-2);
-                change = 1;
-            }
-        }
-    }
-
-    //BORD SANS LES COINS/////////
-    //BORD GAUCHE ET DROIT
-    for (index = 0; index < pa_local_left_border.size ; ++index)
-    {
-        l = pa_local_left_border.array[index].line;
-        current_state = p->data[l * width];
-        if(current_state == lusq_0 || wall_saturated(p,0,l))
-        {
-            if(p->data[(l-1) * width] == lusq_empty) p->data[(l-1) * width] = lusq_impossible;
-            if(p->data[(l+1) * width] == lusq_empty) p->data[(l+1) * width] = lusq_impossible;
-            if(p->data[l * width + 1] == lusq_empty) p->data[l * width + 1] = lusq_impossible;
-            remove_from_position_array(&pa_local_left_border,index);
-            change = 1;
-        }
-        else if(current_state <= lusq_3)
-        {
-            count =
-                (p->data[(l-1) * width] == lusq_empty) +
-                (p->data[(l+1) * width] == lusq_empty) +
-                (p->data[l * width + 1] == lusq_empty) +
-                (p->data[(l-1) * width] == lusq_lbulb) +
-                (p->data[(l+1) * width] == lusq_lbulb) +
-                (p->data[l * width + 1] == lusq_lbulb);
-            if(count == current_state)
-            {
-                if(p->data[(l-1) * width] == lusq_empty) puzzle_light_on(p,0,l-1);
-                if(p->data[(l+1) * width] == lusq_empty) puzzle_light_on(p,0,l+1);
-                if(p->data[l * width + 1] == lusq_empty) puzzle_light_on(p,1,l);
-                remove_from_position_array(&pa_local_left_border,index);
-                index--;
-                change = 1;
-            }
-        }
-    }
-    for (index = 0; index < pa_local_right_border.size ; ++index)
-    {
-        l = pa_local_right_border.array[index].line;
-        current_state = p->data[l * width + width -1];
-        if(current_state == lusq_0 || wall_saturated(p,width-1,l))
-        {
-            if(p->data[(l-1) * width + width-1] == lusq_empty) p->data[(l-1) * width + width-1] = lusq_impossible;
-            if(p->data[(l+1) * width + width-1] == lusq_empty) p->data[(l+1) * width + width-1] = lusq_impossible;
-            if(p->data[l * width + width-2] == lusq_empty) p->data[l * width + width-2] = lusq_impossible;
-            remove_from_position_array(&pa_local_right_border,index);
-            change = 1;
-        }
-        else if(current_state <= lusq_3)
-        {
-            count =
-                (p->data[(l-1) * width + width-1] == lusq_empty) +
-                (p->data[(l+1) * width + width-1] == lusq_empty) +
-                (p->data[l * width + width-2] == lusq_empty) +
-                (p->data[(l-1) * width + width-1] == lusq_lbulb) +
-                (p->data[(l+1) * width + width-1] == lusq_lbulb) +
-                (p->data[l * width + width-2] == lusq_lbulb);
-            if(count == current_state)
-            {
-                if(p->data[(l-1) * width + width-1] == lusq_empty) puzzle_light_on(p,width-1,l-1);
-                if(p->data[(l+1) * width + width-1] == lusq_empty) puzzle_light_on(p,width-1,l+1);
-                if(p->data[l * width + width-2] == lusq_empty) puzzle_light_on(p,width-2,l);
-                remove_from_position_array(&pa_local_right_border,index);
-                index--;
-                change = 1;
-            }
-        }
-    }
-    //BORD HAUT ET BAS
-    for (index = 0; index < pa_local_top_border.size ; ++index)
-    {
-        c = pa_local_top_border.array[index].column;
-        current_state = p->data[c];
-        if(current_state == lusq_0 || wall_saturated(p,c,0))
-        {
-            if(p->data[c-1] == lusq_empty) p->data[c-1] = lusq_impossible;
-            if(p->data[c+1] == lusq_empty) p->data[c+1] = lusq_impossible;
-            if(p->data[width + c] == lusq_empty) p->data[width + c] = lusq_impossible;
-            remove_from_position_array(&pa_local_top_border,index);
-            change = 1;
-        }
-        else if(current_state <= lusq_3)
-        {
-            count =
-                (p->data[c-1] == lusq_empty) +
-                (p->data[c+1] == lusq_empty) +
-                (p->data[width + c] == lusq_empty) +
-                (p->data[c-1] == lusq_lbulb) +
-                (p->data[c+1] == lusq_lbulb) +
-                (p->data[width + c] == lusq_lbulb);
-            if(count == current_state)
-            {
-                if(p->data[c-1] == lusq_empty) puzzle_light_on(p,c-1,0);
-                if(p->data[c+1] == lusq_empty) puzzle_light_on(p,c+1,0);
-                if(p->data[width + c] == lusq_empty) puzzle_light_on(p,c,1);
-                remove_from_position_array(&pa_local_top_border,index);
-                index--;
-                change = 1;
-            }
-        }
-    }
-    for (index = 0; index < pa_local_bottom_border.size ; ++index)
-    {
-        c = pa_local_bottom_border.array[index].column;
-        current_state = p->data[(height-1)*width + c];
-        if(current_state == lusq_0 || wall_saturated(p,c,height-1))
-        {
-            if(p->data[(height-1)*width + c-1] == lusq_empty) p->data[(height-1)*width + c-1] = lusq_impossible;
-            if(p->data[(height-1)*width + c+1] == lusq_empty) p->data[(height-1)*width + c+1] = lusq_impossible;
-            if(p->data[(height-2)*width + c] == lusq_empty) p->data[(height-2)*width +  + c] = lusq_impossible;
-            remove_from_position_array(&pa_local_bottom_border,index);
-            change = 1;
-        }
-        else if(current_state <= lusq_3)
-        {
-            count =
-                (p->data[(height-1)*width + c-1] == lusq_empty) +
-                (p->data[(height-1)*width + c+1] == lusq_empty) +
-                (p->data[(height-2)*width + c] == lusq_empty) +
-                (p->data[(height-1)*width + c-1] == lusq_lbulb) +
-                (p->data[(height-1)*width + c+1] == lusq_lbulb) +
-                (p->data[(height-2)*width + c] == lusq_lbulb);
-            if(count == current_state)
-            {
-                if(p->data[(height-1)*width + c-1] == lusq_empty) puzzle_light_on(p,c-1,height-1);
-                if(p->data[(height-1)*width + c+1] == lusq_empty) puzzle_light_on(p,c+1,height-1);
-                if(p->data[(height-2)*width + c] == lusq_empty) puzzle_light_on(p,c,height-2);
-                remove_from_position_array(&pa_local_bottom_border,index);
-                index--;
-                change = 1;
-            }
-        }
-    }
-
-    //INTERIEUR SANS BORD NI COINS
-    for (index = 0; index < pa_local_center.size ; ++index)
-    {
-        l = pa_local_center.array[index].line;
-        c = pa_local_center.array[index].column;
-        current_state = p->data[l * width + c];
-        if(current_state == lusq_0 || wall_saturated(p,c,l))
-        {
-            if(p->data[(l-1) * width + c] == lusq_empty) p->data[(l-1) * width + c] = lusq_impossible;
-            if(p->data[(l+1) * width + c] == lusq_empty) p->data[(l+1) * width + c] = lusq_impossible;
-            if(p->data[l * width + c - 1] == lusq_empty) p->data[l * width + c - 1] = lusq_impossible;
-            if(p->data[l * width + c + 1] == lusq_empty) p->data[l * width + c + 1] = lusq_impossible;
-            remove_from_position_array(&pa_local_center,index);
-            change = 1;
-        }
-        else if(current_state <= lusq_4)
-        {
-            count = 
-                (p->data[(l-1) * width + c] == lusq_empty) +
-                (p->data[(l+1) * width + c] == lusq_empty) +
-                (p->data[l * width + c - 1] == lusq_empty) +
-                (p->data[l * width + c + 1] == lusq_empty) +
-                (p->data[(l-1) * width + c] == lusq_lbulb) +
-                (p->data[(l+1) * width + c] == lusq_lbulb) +
-                (p->data[l * width + c - 1] == lusq_lbulb) +
-                (p->data[l * width + c + 1] == lusq_lbulb);
-            if(count == current_state)
-            {
-                if(p->data[(l-1) * width + c] == lusq_empty) puzzle_light_on(p,c,l-1);
-                if(p->data[(l+1) * width + c] == lusq_empty) puzzle_light_on(p,c,l+1);
-                if(p->data[l * width + c - 1] == lusq_empty) puzzle_light_on(p,c-1,l);
-                if(p->data[l * width + c + 1] == lusq_empty) puzzle_light_on(p,c+1,l);
-                remove_from_position_array(&pa_local_center,index);
-                index--;
-                change = 1;
-            }
-        }
-    }
-
-    
-    *pa_center = pa_local_center;
-    *pa_left_border = pa_local_left_border;
-    *pa_right_border = pa_local_right_border;
-    *pa_top_border = pa_local_top_border; 
-    *pa_bottom_border = pa_local_bottom_border;
-
-    return change;
+    if(p->data[idx] > lusq_4) return 0;
+    return ((l > 0) && (p->data[idx - p->width] == lusq_empty))
+        || ((l < p->height - 1) && (p->data[idx + p->width] == lusq_empty))
+        || ((c > 0) && (p->data[idx - 1] == lusq_empty))
+        || ((c < p->width - 1) && (p->data[idx + 1] == lusq_empty));
 }
 
-
-char empty_and_impossible_heuristic(lu_puzzle * p, position_array * pa_empty, position_array * pa_impossible)
-{
-    unsigned int c = 0,
-                 l = 0,
-                 index = 0;
-
-    unsigned char change = 0;
-    
-    unsigned int width = p->width;
-
-    position_array pa_local_empty = *pa_empty,
-                   pa_local_impossible = *pa_impossible;
-
-
-    position lb_pos = {0,0};
-    for(index = 0; index < pa_local_impossible.size ; index++)
-    {
-        l = pa_local_impossible.array[index].line;
-        c = pa_local_impossible.array[index].column;
-    
-        if(p->data[l * width + c] != lusq_impossible)
-        {
-            remove_from_position_array(&pa_local_impossible, index);
-            index--;
-        }
-        else if(number_of_lightbulb_possible(p, l, c, &lb_pos) == 1)
-        {
-            puzzle_light_on(p, lb_pos.column, lb_pos.line);
-            remove_from_position_array(&pa_local_impossible, index);
-            index--;
-            change = 1;
-        }
-    }
-    //Essaye de remplir les cases vides qui doivent s'éclairer eux même (lorsqu'aucune case n'est libre autour d'eux pour l'éclairer).
-    for(index = 0; index < pa_local_empty.size ; index++)
-    {
-        l = pa_local_empty.array[index].line;
-        c = pa_local_empty.array[index].column;
-    
-        if(p->data[l * width + c] != lusq_empty)
-        {
-            if(p->data[l * width + c] == lusq_impossible)
-            {
-                add_to_position_array(&pa_local_impossible, pa_local_empty.array[index]);
-                change = 1;
-            }
-            remove_from_position_array(&pa_local_empty, index);
-            index--;
-        }
-        else if(is_alone(p, l, c) == 1)
-        {
-            puzzle_light_on(p, pa_local_empty.array[index].column, pa_local_empty.array[index].line);
-            remove_from_position_array(&pa_local_empty, index);
-            index--;
-            change = 1;
-        }
-    }
-
-    *pa_empty = pa_local_empty;
-    *pa_impossible = pa_local_impossible;
-
-    return change;
-}
-
-void pre_solve(lu_puzzle *p, position_array * positions_empty,
+//Les déductions sont propagées par files d'attente (voir lu_propagate) :
+//chaque case fixée ne réveille que ses murs voisins et ses segments.
+//positions_empty et positions_impossible reçoivent ensuite les cases
+//restantes dans l'ordre de la grille, les listes de murs les murs numérotés
+//qui ont encore un voisin vide.
+//Avec --2sat, les clauses binaires sont ensuite exploitées sur toute la
+//grille (propagate_twosat()) ; avec --probe, les cases vides restantes sont
+//sondées (propagate_probe()).
+void pre_solve(lu_puzzle *p, lu_segments *segs, const lu_options *opt, position_array * positions_empty,
         position_array * positions_impossible,position_array * left,
         position_array * right, position_array * top, position_array * bottom,
         position_array * center)
@@ -658,14 +83,13 @@ void pre_solve(lu_puzzle *p, position_array * positions_empty,
                  l = 0,
                  index = 0;
 
-    unsigned int change = 0;
-    
     unsigned int width = p->width;
     unsigned int height = p->height;
 
-    
-    position_array pa_empty = new_position_array();
-    position_array pa_impossible = new_position_array();
+    lu_propagate * prop;
+
+    position_array pa_empty = new_position_array_with_size(width * height);
+    position_array pa_impossible = new_position_array_with_size(width * height);
 
     position_array pa_center = new_position_array_with_size((width-2)*(height-2));
     position_array pa_left_border = new_position_array_with_size(height);
@@ -673,16 +97,32 @@ void pre_solve(lu_puzzle *p, position_array * positions_empty,
     position_array pa_top_border = new_position_array_with_size(width);
     position_array pa_bottom_border = new_position_array_with_size(width);
 
+    /////////////////////////////////////////
+    //PROPAGATION DES CONTRAINTES DES MURS ET DES CASES IMPOSSIBLES
+    /////////////////////////////////////////
+    prop = propagate_new(p, segs);
+    propagate_wake_all(prop, p);
+    propagate_run(prop, p);
+    if(opt->twosat)
+    {
+        unsigned int nb_equiv = 0;
+        unsigned int nb_fixed = propagate_twosat(prop, p, &nb_equiv);
+        printf("2-SAT fixed %u cells (%u equivalent cells)\n", nb_fixed, nb_equiv);
+    }
+    if(opt->probe)
+    {
+        printf("Probing fixed %u cells\n", propagate_probe(prop, p));
+    }
+    propagate_destroy(prop);
 
-
-    //Filling the array of wall with number on it
+    //Murs numérotés encore ouverts
     index = 0;
     for (l = 1; l < p->height-1; ++l)
     {
         for (c = 1; c < p->width -1; ++c)
         {
             pa_center.array[index] = (position){l,c};
-            index += (p->data[l * width + c] <= lusq_4);
+            index += wall_open(p, l, c);
         }
     }
     pa_center.size = index;
@@ -691,47 +131,31 @@ void pre_solve(lu_puzzle *p, position_array * positions_empty,
     for (l = 1; l < height-1; ++l)
     {
         pa_left_border.array[index] = (position){l,0};
-        index += (p->data[l * width] <= lusq_4);
+        index += wall_open(p, l, 0);
     }
     pa_left_border.size = index;
     index = 0;
     for (l = 1; l < height-1; ++l)
     {
         pa_right_border.array[index] = (position){l,width-1};
-        index += (p->data[l * width + width -1] <= lusq_4);
+        index += wall_open(p, l, width-1);
     }
     pa_right_border.size = index;
     index = 0;
     for (c = 1; c < width-1; ++c)
     {
         pa_top_border.array[index] = (position){0,c};
-        index += (p->data[c] <= lusq_4);
+        index += wall_open(p, 0, c);
     }
     pa_top_border.size = index;
     index = 0;
     for (c = 1; c < width-1; ++c)
     {
         pa_bottom_border.array[index] = (position){height-1,c};
-        index += (p->data[(height-1)*width + c] <= lusq_4);
+        index += wall_open(p, height-1, c);
     }
     pa_bottom_border.size = index;
 
-    /////////////////////////////////////////
-    //APPEL A LA FONCTION HEURISTIC QUI REMPLIE LES CASES VIDES SELON LES CONTRAINTES DES MURS
-    /////////////////////////////////////////
-    do
-    {
-        change = wall_heuristic(
-                p, 
-                &pa_left_border,
-                &pa_right_border,
-                &pa_top_border,
-                &pa_bottom_border,
-                &pa_center);
-    }
-    while(change != 0);
-
-
     unsigned index_empty = 0, index_impossible = 0;
     for (l = 0; l < p->height; ++l)
     {
@@ -746,32 +170,6 @@ void pre_solve(lu_puzzle *p, position_array * positions_empty,
     pa_empty.size = index_empty;
     pa_impossible.size = index_impossible;
 
-    
-    do
-    {
-        change = 0;
-
-        change += empty_and_impossible_heuristic(
-                p, 
-                &pa_empty,
-                &pa_impossible);
-
-        /////////////////////////////////////////
-        //APPEL A LA FONCTION HEURISTIC QUI REMPLIE LES CASES VIDES SELON LES CONTRAINTES DES MURS
-        /////////////////////////////////////////
-        change += wall_heuristic(
-                p, 
-                &pa_left_border,
-                &pa_right_border,
-                &pa_top_border,
-                &pa_bottom_border,
-                &pa_center);
-    }
-    while(change != 0);
-
-
-
-
     *positions_empty = pa_empty;
     *positions_impossible = pa_impossible;
     *left = pa_left_border;
@@ -899,28 +297,20 @@ void classify_positions(lu_puzzle *p, position_array ** pa_array_empty, position
 }
 
 //Regarde s'il est possible d'allumer cette emplacement (si l'emplacement est déjà allumé, ou si il y a conflit avec un mur à coté).
-int impossible_to_light(lu_puzzle *p, position pos)
+int impossible_to_light(lu_puzzle *p, const lu_segments *segs, const lu_walls *walls, position pos)
 {
-    char boolean = 0;
-    boolean = (p->data[pos.line * p->width + pos.column] != lusq_empty)
-    || wall_saturated(p,pos.column - 1, pos.line)
-    || wall_saturated(p,pos.column + 1, pos.line)
-    || wall_saturated(p,pos.column, pos.line-1)
-    || wall_saturated(p,pos.column, pos.line+1);
-
-    return boolean;
+    unsigned int idx = pos.line * p->width + pos.column;
+
+    return (p->data[idx] != lusq_empty)
+    || segments_is_lit(segs, idx)
+    || walls_blocked(walls, idx);
 }
 
-int possible_to_light(lu_puzzle *p, position pos)
+int possible_to_light(lu_puzzle *p, const lu_walls *walls, position pos)
 {
-    char boolean = 0;
-    boolean = (p->data[pos.line * p->width + pos.column] == lusq_empty)
-    && !wall_saturated(p,pos.column - 1, pos.line)
-    && !wall_saturated(p,pos.column + 1, pos.line)
-    && !wall_saturated(p,pos.column, pos.line-1)
-    && !wall_saturated(p,pos.column, pos.line+1);
-
-    return boolean;
+    unsigned int idx = pos.line * p->width + pos.column;
+
+    return (p->data[idx] == lusq_empty) && !walls_blocked(walls, idx);
 }
 
 
@@ -946,49 +336,85 @@ int solution_is_complete(lu_puzzle *p, position_array pa_empty, position_array p
 }
 
 
+/** Nombre d'intervalles du produit des classes par thread */
+#define PRODUCT_RANGES_PER_THREAD 16
+
+//Ajoute la solution courante (terminée par -1) à la liste des solutions.
+void push_solution(int_array * solutions, int_array * ia_current_solution)
+{
+    if((solutions->size + ia_current_solution->size + 1) > solutions->max_size)
+    {
+        solutions->max_size = (solutions->max_size + ia_current_solution->size + 1) * 2;
+        solutions->array = (int*)realloc(solutions->array, sizeof(int) * solutions->max_size);
+    }
+    memcpy(&solutions->array[solutions->size], ia_current_solution->array, sizeof(*ia_current_solution->array) * ia_current_solution->size);
+    solutions->size += ia_current_solution->size;
+    add_to_int_array(solutions, -1);
+}
+
 /*!
- * Résoud un puzzle light-up de façon itérative.
+ * Version de solve() pour les grilles d'au plus BB_MAX lignes et colonnes :
+ * l'état (ampoules, cases allumées, murs) est maintenu dans des bitboards,
+ * p->data n'est jamais modifié. Une ampoule se place avec quelques
+ * opérations sur des masques et n'a besoin que de deux masques pour être
+ * retirée.
  */
-void solve(lu_puzzle *p, position_array pa_empty, position_array pa_impossible, int_array * solutions, unsigned int *sol_id) 
+void solve_bitboard(lu_puzzle *p, lu_bitboard *bb, lu_walls *walls, lu_cover *cover, position_array pa_empty, position_array pa_impossible, int_array * solutions, unsigned int *sol_id)
 {
-    unsigned int index = 0, sol_id_local = 0, useless = 0;
-    wh_bufs * whbufs = new_wh_bufs(p->width, p->height, pa_empty.size);
-    char *wbuf = NULL, *hbuf = NULL;
-    int empty_count = pa_empty.size + pa_impossible.size;
+    unsigned int index = 0, sol_id_local = 0;
+    unsigned int depth, idx;
+    position pos;
+    int empty_count = bb_set_targets(bb, pa_empty, pa_impossible);
+    int hopeless = cover_init(cover, p, pa_empty, pa_impossible);
 
-    int_array ia_current_solution = new_int_array();
+    //Masques des cases allumées par chaque ampoule de la solution courante
+    lu_bits * undo_h = (lu_bits*) malloc(sizeof(lu_bits) * (pa_empty.size + 1));
+    lu_bits * undo_v = (lu_bits*) malloc(sizeof(lu_bits) * (pa_empty.size + 1));
+
+    int_array ia_current_solution = new_int_array_with_size(pa_empty.size);
     *solutions = new_int_array();
+    if(hopeless) index = pa_empty.size;
     do
     {
-        useless++;  //FIXME
-        while((index < pa_empty.size) && impossible_to_light(p, pa_empty.array[index])) index++;
+        while((index < pa_empty.size)
+                && (bb_is_lit(bb, pa_empty.array[index].column, pa_empty.array[index].line)
+                    || walls_blocked(walls, pa_empty.array[index].line * p->width + pa_empty.array[index].column))) index++;
         if(index < pa_empty.size)
         {
-            pop_wh_buf(whbufs, &wbuf, &hbuf);
-            puzzle_light_on_with_bufs(p, pa_empty.array[index].column, pa_empty.array[index].line, wbuf, hbuf, &empty_count);
-            add_to_int_array(&ia_current_solution, index);
+            pos = pa_empty.array[index];
+            idx = pos.line * p->width + pos.column;
+            depth = ia_current_solution.size;
+            empty_count -= bb_light_on(bb, pos.column, pos.line, &undo_h[depth], &undo_v[depth]);
+            walls_bulb_on(walls, idx);
+            if(cover_bulb_on(cover, p, idx))
+            {
+                //Un mur ne peut plus être satisfait ou une case ne peut plus
+                //être éclairée : branche morte, la case est dépassée
+                cover_bulb_off(cover, idx);
+                walls_bulb_off(walls, idx);
+                empty_count += bb_light_off(bb, pos.column, pos.line, undo_h[depth], undo_v[depth]);
+                if(cover_remove(cover, p, idx)) index = pa_empty.size - 1;
+            }
+            else add_to_int_array(&ia_current_solution, index);
         }
         else
         {
-            //if(solution_is_complete(p, pa_empty, pa_impossible) == 1)
-            if(empty_count <= 0)
+            if((empty_count <= 0) && (walls->unsat == 0))
             {
-                if((solutions->size + ia_current_solution.size + 1) > solutions->max_size)
-                {
-                    solutions->max_size *= 2;
-                    solutions->array = (int*)realloc(solutions->array, sizeof(int) * solutions->max_size);
-                }
-                memcpy(&solutions->array[solutions->size], ia_current_solution.array, sizeof(*ia_current_solution.array) * ia_current_solution.size);
-                solutions->size += ia_current_solution.size;
-                add_to_int_array(solutions, -1);
+                push_solution(solutions, &ia_current_solution);
                 sol_id_local++;
             }
-            
-            --ia_current_solution.size;
-            index = ia_current_solution.array[ia_current_solution.size];//Dépile le dernier élément qui ne sert à rien
-            get_head_wh_buf(whbufs, &wbuf, &hbuf);
-            puzzle_light_off_with_bufs(p, pa_empty.array[index].column, pa_empty.array[index].line, wbuf, hbuf, &empty_count);
-            release_wh_buf(whbufs);
+
+            if(ia_current_solution.size == 0) break;
+            depth = --ia_current_solution.size;
+            index = ia_current_solution.array[depth];//Dépile le dernier élément qui ne sert à rien
+            pos = pa_empty.array[index];
+            idx = pos.line * p->width + pos.column;
+            cover_bulb_off(cover, idx);
+            walls_bulb_off(walls, idx);
+            empty_count += bb_light_off(bb, pos.column, pos.line, undo_h[depth], undo_v[depth]);
+            //La case est dépassée : plus aucune ampoule ne pourra y être posée
+            if(cover_remove(cover, p, idx)) index = pa_empty.size - 1;
         }
         index++;
     }
@@ -996,126 +422,190 @@ void solve(lu_puzzle *p, position_array pa_empty, position_array pa_impossible,
 
     add_to_int_array(solutions, -2);
     *sol_id = sol_id_local;
-    free_wh_bufs(whbufs);
+    cover_clear(cover, p, pa_empty);
+    delete_int_array(&ia_current_solution);
+    free(undo_h);
+    free(undo_v);
 }
 
+static int compare_int(const void *a, const void *b)
+{
+    return *(const int*)a - *(const int*)b;
+}
 
-int verify_solution(lu_puzzle *p, position_array left, position_array right, position_array top, position_array bottom, position_array center)
+/*!
+ * Recherche d'une classe par décisions binaires (ampoule / pas d'ampoule)
+ * sur la case choisie par cover_pick(). Seuls la couverture et les murs sont
+ * utilisés. Produit les mêmes solutions que l'ordre statique, dans un autre
+ * ordre ; chaque solution est triée par index croissant.
+ */
+void solve_mcv(lu_puzzle *p, lu_walls *walls, lu_cover *cover, position_array pa_empty, position_array pa_impossible, int_array * solutions, unsigned int *sol_id)
 {
-    unsigned char boolean = 1;
-    unsigned int index = 0, lbulb_count = 0;
-    position pos;
+    unsigned int index, sol_id_local = 0;
+    int cell, dead = cover_init(cover, p, pa_empty, pa_impossible);
 
-    unsigned int width = p->width, height = p->height;
+    //Décisions en cours : index de la case de l'ampoule, ou -1 - index si la
+    //case a été écartée
+    int_array decisions = new_int_array_with_size(pa_empty.size);
+    int_array ia_current_solution = new_int_array_with_size(pa_empty.size);
 
-    //COINS
-    //Coins haut gauche
-    if(p->data[0] == lusq_1)
+    *solutions = new_int_array();
+    for(;;)
     {
-        boolean = boolean && ((p->data[1] == lusq_lbulb) || (p->data[width] == lusq_lbulb));
-    }
+        if(!dead)
+        {
+            cell = cover_pick(cover, p, pa_empty, pa_impossible);
+            if(cell >= 0)
+            {
+                walls_bulb_on(walls, cell);
+                dead = cover_bulb_on(cover, p, cell);
+                add_to_int_array(&decisions, cell);
+                continue;
+            }
 
-    //Coins haut droit
-    if(p->data[width-1] == lusq_1)
-    {
-        boolean = boolean && ((p->data[width-2] == lusq_lbulb) || (p->data[2*width-1] == lusq_lbulb));
-    }
+            //Toutes les cases sont éclairées
+            if(walls->unsat == 0)
+            {
+                ia_current_solution.size = 0;
+                for(index = 0; index < decisions.size; index++)
+                {
+                    if(decisions.array[index] >= 0) add_to_int_array(&ia_current_solution, cover->rank[decisions.array[index]]);
+                }
+                qsort(ia_current_solution.array, ia_current_solution.size, sizeof(int), compare_int);
+                push_solution(solutions, &ia_current_solution);
+                sol_id_local++;
+            }
+        }
 
-    //Coins bottom gauche
-    if(p->data[width*(height-1)] == lusq_1)
-    {
-        boolean = boolean && ((p->data[width*(height-2)] == lusq_lbulb) || (p->data[width*(height-1) + 1] == lusq_lbulb));
+        //Retour arrière : la dernière ampoule devient une case écartée
+        dead = 1;
+        while(dead && (decisions.size > 0))
+        {
+            cell = decisions.array[--decisions.size];
+            if(cell < 0)
+            {
+                cover_unskip(cover);
+                continue;
+            }
+            cover_bulb_off(cover, cell);
+            walls_bulb_off(walls, cell);
+            dead = cover_skip(cover, p, cell);
+            add_to_int_array(&decisions, -1 - cell);
+        }
+        if(dead) break;
     }
 
-    //Coins bottom right
-    if(p->data[width*height - 1] == lusq_1)
-    {
-        boolean = boolean && ((p->data[width*(height-1) - 1] == lusq_lbulb) || (p->data[width*height - 2 + 1] == lusq_lbulb));
-    }
+    add_to_int_array(solutions, -2);
+    *sol_id = sol_id_local;
+    cover_clear(cover, p, pa_empty);
+    delete_int_array(&decisions);
+    delete_int_array(&ia_current_solution);
+}
 
-    //Bord gauche
-    for(index = 0; index < left.size && boolean ; index++)
+/*!
+ * Résoud un puzzle light-up de façon itérative.
+ */
+void solve(lu_puzzle *p, lu_segments *segs, lu_walls *walls, lu_cover *cover, const lu_options *opt, position_array pa_empty, position_array pa_impossible, int_array * solutions, unsigned int *sol_id)
+{
+    if(opt->order == ORDER_MCV)
     {
-        pos = left.array[index];
-
-        lbulb_count = (
-                (p->data[(pos.line-1)*width] == lusq_lbulb) +
-                (p->data[(pos.line)*width + 1] == lusq_lbulb) +
-                (p->data[(pos.line+1)*width] == lusq_lbulb));
-
-        boolean = boolean && (lbulb_count == p->data[pos.line * width + pos.column]);
+        solve_mcv(p, walls, cover, pa_empty, pa_impossible, solutions, sol_id);
+        return;
     }
-    
-    //Bord droit
-    for(index = 0; index < right.size && boolean ; index++)
+    if(opt->order == ORDER_CBJ)
     {
-        pos = right.array[index];
-
-        lbulb_count = (
-                (p->data[(pos.line-1)*width] == lusq_lbulb) +
-                (p->data[(pos.line)*width - 1] == lusq_lbulb) +
-                (p->data[(pos.line+1)*width] == lusq_lbulb));
-
-        boolean = boolean && (lbulb_count == p->data[pos.line * width + pos.column]);
+        lu_cbj * cbj = cbj_new(cover, pa_empty.size);
+        cbj_solve(cbj, p, pa_empty, pa_impossible, solutions, sol_id);
+        cbj_destroy(cbj);
+        return;
     }
 
-    //Bord haut
-    for(index = 0; index < top.size && boolean ; index++)
+    lu_bitboard * bb = bb_new(p);
+    if(bb != NULL)
     {
-        pos = top.array[index];
-
-        lbulb_count = (
-                (p->data[(pos.line)*width + pos.column - 1] == lusq_lbulb) +
-                (p->data[(pos.line)*width + pos.column + 1] == lusq_lbulb) +
-                (p->data[(pos.line+1)*width + pos.column] == lusq_lbulb));
-
-        boolean = boolean && (lbulb_count == p->data[pos.line * width + pos.column]);
+        solve_bitboard(p, bb, walls, cover, pa_empty, pa_impossible, solutions, sol_id);
+        bb_destroy(bb);
+        return;
     }
 
-    //Bord bas
-    for(index = 0; index < bottom.size && boolean ; index++)
-    {
-        pos = bottom.array[index];
+    //Grilles trop grandes pour les bitboards : une ampoule ne fait
+    //qu'incrémenter les compteurs de ses deux segments, les cases qu'elle
+    //éclaire ne sont ni parcourues ni comptées. La couverture garantit
+    //qu'une branche vivante sans plus de candidate a tout éclairé ; dead
+    //note la mort de la branche courante.
+    unsigned int index = 0, sol_id_local = 0;
+    unsigned int idx;
+    int dead = cover_init(cover, p, pa_empty, pa_impossible);
 
-        lbulb_count = (
-                (p->data[(pos.line)*width + pos.column - 1] == lusq_lbulb) +
-                (p->data[(pos.line)*width + pos.column + 1] == lusq_lbulb) +
-                (p->data[(pos.line-1)*width + pos.column] == lusq_lbulb));
-
-        boolean = boolean && (lbulb_count == p->data[pos.line * width + pos.column]);
-    }
-
-    for(index = 0; index < center.size && boolean ; index++)
+    int_array ia_current_solution = new_int_array_with_size(pa_empty.size);
+    *solutions = new_int_array();
+    if(dead) index = pa_empty.size;
+    do
     {
-        pos = center.array[index];
-
-        lbulb_count = (
-                (p->data[(pos.line)*width + pos.column - 1] == lusq_lbulb) +
-                (p->data[(pos.line)*width + pos.column + 1] == lusq_lbulb) +
-                (p->data[(pos.line-1)*width + pos.column] == lusq_lbulb) +
-                (p->data[(pos.line+1)*width + pos.column] == lusq_lbulb));
-        boolean = boolean && (lbulb_count == p->data[pos.line * width + pos.column]);
+        while((index < pa_empty.size) && impossible_to_light(p, segs, walls, pa_empty.array[index])) index++;
+        if(index < pa_empty.size)
+        {
+            idx = pa_empty.array[index].line * p->width + pa_empty.array[index].column;
+            segments_set_square(segs, p, idx, lusq_lbulb);
+            walls_bulb_on(walls, idx);
+            if(cover_bulb_on(cover, p, idx))
+            {
+                //Un mur ne peut plus être satisfait ou une case ne peut plus
+                //être éclairée : branche morte, la case est dépassée
+                cover_bulb_off(cover, idx);
+                walls_bulb_off(walls, idx);
+                segments_set_square(segs, p, idx, lusq_empty);
+                dead = cover_remove(cover, p, idx);
+                if(dead) index = pa_empty.size - 1;
+            }
+            else add_to_int_array(&ia_current_solution, index);
+        }
+        else
+        {
+            if(!dead && (walls->unsat == 0))
+            {
+                push_solution(solutions, &ia_current_solution);
+                sol_id_local++;
+            }
+
+            if(ia_current_solution.size == 0) break;
+            --ia_current_solution.size;
+            index = ia_current_solution.array[ia_current_solution.size];//Dépile le dernier élément qui ne sert à rien
+            idx = pa_empty.array[index].line * p->width + pa_empty.array[index].column;
+            cover_bulb_off(cover, idx);
+            walls_bulb_off(walls, idx);
+            segments_set_square(segs, p, idx, lusq_empty);
+            //La case est dépassée : plus aucune ampoule ne pourra y être posée
+            dead = cover_remove(cover, p, idx);
+            if(dead) index = pa_empty.size - 1;
+        }
+        index++;
     }
+    while((ia_current_solution.size > 0) || (index < pa_empty.size));
 
-    return boolean;
+    add_to_int_array(solutions, -2);
+    *sol_id = sol_id_local;
+    cover_clear(cover, p, pa_empty);
+    delete_int_array(&ia_current_solution);
 }
 
+
 //Essaye la solution (délimité à la fin par un -1). Si à un moment, la solution coince, les ampoules placés
 //pour tester la solution sont enlevées.
 //Si la solution est possible, la fonction renvoie la taille de la solution
 //Si la solution échoue, la fonction renvoie 0
-int try_solution(lu_puzzle * p, position_array pa_empty, int * solution)
+int try_solution(lu_puzzle * p, lu_walls *walls, position_array pa_empty, int * solution)
 {
     int i = 0;
-    unsigned int width = p->width;
-    position pos;
+    unsigned int idx;
 
     if(solution[i] == -2) return 0;
 
-    while((solution[i] != -1) && (possible_to_light(p, pa_empty.array[solution[i]]) == 1))
+    while((solution[i] != -1) && (possible_to_light(p, walls, pa_empty.array[solution[i]]) == 1))
     {
-        pos = pa_empty.array[solution[i]];
-        p->data[pos.line * width + pos.column] = lusq_lbulb;
+        idx = pa_empty.array[solution[i]].line * p->width + pa_empty.array[solution[i]].column;
+        p->data[idx] = lusq_lbulb;
+        walls_bulb_on(walls, idx);
         i++;
     }
 
@@ -1123,31 +613,54 @@ int try_solution(lu_puzzle * p, position_array pa_empty, int * solution)
     {
         for(i = i-1 ; i >= 0 ; i--)
         {
-            pos = pa_empty.array[solution[i]];
-            p->data[pos.line * width + pos.column] = lusq_empty;
+            idx = pa_empty.array[solution[i]].line * p->width + pa_empty.array[solution[i]].column;
+            p->data[idx] = lusq_empty;
+            walls_bulb_off(walls, idx);
         }
+        i = 0;
     }
     return i;
 }
 
 //Remove the lightbulb of a solution from the puzzle.
 //La fonction revoie la taille de la solution
-int remove_solution(lu_puzzle * p, position_array pa_empty, int * solution)
+int remove_solution(lu_puzzle * p, lu_walls *walls, position_array pa_empty, int * solution)
 {
     int i = 0;
-    unsigned int width = p->width;
-    position pos;
+    unsigned int idx;
 
     while(solution[i] != -1)
     {
-        pos = pa_empty.array[solution[i]];
-        p->data[pos.line * width + pos.column] = lusq_empty;
+        idx = pa_empty.array[solution[i]].line * p->width + pa_empty.array[solution[i]].column;
+        p->data[idx] = lusq_empty;
+        walls_bulb_off(walls, idx);
         i++;
     }
     return i++;
 }
 
 
+//Pose (sq == lusq_lbulb) ou enlève (sq == lusq_empty) les ampoules d'une
+//solution donnée par son masque de bits sur pa_empty. La jointure garantit
+//qu'aucun mur n'est dépassé : aucune vérification n'est faite.
+void set_solution_bits(lu_puzzle * p, lu_walls *walls, position_array pa_empty, const lu_bits * solution, unsigned int nb_words, lu_square sq)
+{
+    unsigned int w, i, idx;
+    lu_bits bits;
+
+    for(w = 0; w < nb_words; w++)
+    {
+        for(bits = solution[w]; bits; bits &= bits - 1)
+        {
+            i = 64 * w + __builtin_ctzll(bits);
+            idx = pa_empty.array[i].line * p->width + pa_empty.array[i].column;
+            p->data[idx] = sq;
+            if(sq == lusq_lbulb) walls_bulb_on(walls, idx);
+            else walls_bulb_off(walls, idx);
+        }
+    }
+}
+
 void remove_impossible(lu_puzzle * p)
 {
     unsigned int i = 0, size = p->width * p->height;
@@ -1157,107 +670,667 @@ void remove_impossible(lu_puzzle * p)
     }
 }
 
-void write_solutions(lu_puzzle * p, position_array * classes, int_array * classes_solutions, unsigned int nb_classes, unsigned int *sol_id, FILE *fd)
+//Parcourt le produit des solutions des classes [first, nb_classes[ (la
+//première varie le moins vite) et écrit chaque grille dont les murs partagés
+//sont satisfaits. Les ampoules des classes précédentes sont déjà posées.
+//Seules les solutions compatibles avec les murs partagés sont essayées.
+//Chaque grille trouvée est complétée par le produit des classes libres de
+//gray s'il y en a un.
+//Avec out NULL, les grilles sont seulement comptées.
+//La fonction renvoie le nombre de grilles écrites.
+unsigned long long write_product(lu_puzzle * p, lu_walls *walls, position_array * classes, lu_bitsol * classes_solutions, const lu_join * join, lu_join_cursor * cur, lu_gray * gray, unsigned int first, unsigned int nb_classes, lu_emit *out)
 {
-    int i = 0;
-    int sol_id_local = 0;
+    int k;
+    unsigned int cls = first;
+    unsigned long long sol_id_local = 0;
     int * stack = NULL;
-    unsigned int stack_size = 0;
 
-    if(*sol_id == 0)
+    if(first == nb_classes)
     {
-        puzzle_store(p,fd);
-        *sol_id = 1;
-        return;
+        if(walls->unsat != 0) return 0;
+        if(gray != NULL) return (out != NULL) ? gray_write(gray, p, out) : gray_size(gray);
+        if(out != NULL) emit_grid(out, p);
+        return 1;
     }
-    remove_impossible(p);
 
     stack = (int*) malloc(sizeof(int) * nb_classes);
-    
-    while((stack_size > 0) || (classes_solutions[stack_size].array[i] != -2))
+    join_start(join, cur, walls, cls);
+
+    for(;;)
     {
-        while((classes_solutions[stack_size].array[i] != -2) && (try_solution(p, classes[stack_size], &classes_solutions[stack_size].array[i]) == 0))
+        k = join_next(join, cur, cls);
+        if(k < 0)
         {
-            i++;
+            //Plus de solution compatible pour cette classe : on remonte
+            if(cls == first) break;
+            --cls;
+            set_solution_bits(p, walls, classes[cls], bitsol_get(&classes_solutions[cls], stack[cls]), classes_solutions[cls].nb_words, lusq_empty);
+            continue;
+        }
+        set_solution_bits(p, walls, classes[cls], bitsol_get(&classes_solutions[cls], k), classes_solutions[cls].nb_words, lusq_lbulb);
+        stack[cls] = k;
+        cls++;
+        if(cls < nb_classes)
+        {
+            join_start(join, cur, walls, cls);
+            continue;
+        }
+
+        //Les murs d'une seule classe sont déjà satisfaits, il ne reste
+        //que les murs partagés entre classes (et ceux sans voisin vide)
+        if(walls->unsat == 0)
+        {
+            if(gray != NULL)
+            {
+                sol_id_local += (out != NULL) ? gray_write(gray, p, out) : gray_size(gray);
+            }
+            else
+            {
+                if(out != NULL) emit_grid(out, p);
+                sol_id_local++;
+            }
         }
-        if(classes_solutions[stack_size].array[i] != -2)
+        --cls;
+        set_solution_bits(p, walls, classes[cls], bitsol_get(&classes_solutions[cls], stack[cls]), classes_solutions[cls].nb_words, lusq_empty);
+    }
+    free(stack);
+    return sol_id_local;
+}
+
+//Une classe est couplée aux autres si une de ses cases touche un mur partagé
+int class_is_coupled(const lu_puzzle *p, const lu_walls *walls, position_array pa)
+{
+    unsigned int index, i, c;
+    int w;
+
+    for(index = 0; index < pa.size; index++)
+    {
+        c = pa.array[index].line * p->width + pa.array[index].column;
+        for(i = 0; i < 4; i++)
         {
-            stack[stack_size] = i;
-            stack_size++;
-            i = 0;
+            w = walls->adj[4 * c + i];
+            if((w >= 0) && (walls->owner[w] == WALL_SHARED)) return 1;
+        }
+    }
+    return 0;
+}
+
+//Parcourt les combinaisons [lo, hi[ des depth premières classes (numérotées
+//en base mixte, voir write_solutions) : chacune est posée puis complétée par
+//write_product(). Une solution incompatible saute toutes les combinaisons
+//qui la contiennent.
+unsigned long long write_range(lu_puzzle * p, lu_walls *walls, position_array * classes, lu_bitsol * classes_solutions, const lu_join * join, lu_join_cursor * cur, lu_gray * gray, const unsigned long long *stride, unsigned int depth, unsigned int nb_coupled, unsigned long long lo, unsigned long long hi, lu_emit *out)
+{
+    unsigned long long idx, step, sol_id_local = 0;
+    unsigned int c;
+    int k;
+
+    for(idx = lo; idx < hi; idx += step)
+    {
+        for(c = 0; c < depth; c++)
+        {
+            k = (idx / stride[c + 1]) % join->classes[c].nb_solutions;
+            if(!join_compatible(join, walls, c, k)) break;
+            set_solution_bits(p, walls, classes[c], bitsol_get(&classes_solutions[c], k), classes_solutions[c].nb_words, lusq_lbulb);
+        }
+        if(c == depth)
+        {
+            sol_id_local += write_product(p, walls, classes, classes_solutions, join, cur, gray, depth, nb_coupled, out);
+            step = 1;
         }
         else
         {
-            --stack_size;
-            i = stack[stack_size];
-            i += remove_solution(p, classes[stack_size], &classes_solutions[stack_size].array[i]) + 1;
+            //La solution de la classe c coince : toutes les
+            //combinaisons qui la contiennent sont sautées
+            step = stride[c + 1] - idx % stride[c + 1];
+        }
+        while(c-- > 0)
+        {
+            k = (idx / stride[c + 1]) % join->classes[c].nb_solutions;
+            set_solution_bits(p, walls, classes[c], bitsol_get(&classes_solutions[c], k), classes_solutions[c].nb_words, lusq_empty);
+        }
+    }
+    return sol_id_local;
+}
+
+//Parcourt en parallèle les nb_ranges intervalles du produit, chaque thread
+//sur sa copie de la grille. Sans counts, les intervalles sont pris dans
+//l'ordre et écrits à tour de rôle : les grilles d'un intervalle attendent
+//son tour dans un tampon privé de taille fixe (la mémoire du writer
+//partagée entre les threads) et, une fois le tampon plein, le thread attend
+//ce tour pour écrire directement la suite.
+//Avec counts mais sans mapped, counts[r + 1] reçoit le nombre de grilles de
+//l'intervalle r ; avec mapped, counts[r] est le nombre de grilles avant
+//l'intervalle r et chacune est écrite directement à sa place. Un intervalle
+//qui ne remplit pas exactement sa zone est compté dans *nb_bad.
+unsigned long long write_ranges(lu_puzzle * p, lu_walls *walls, position_array * classes, lu_bitsol * classes_solutions, const lu_join * join, unsigned int nb_coupled, unsigned int nb_classes, const unsigned long long *stride, unsigned int depth, unsigned long long total, unsigned long long nb_ranges, unsigned long long *counts, unsigned char *mapped, unsigned int *nb_bad, lu_writer *wr)
+{
+    size_t record = sizeof(*p->data) * p->width * p->height;
+    unsigned long long sol_id_local = 0;
+    unsigned int bad = 0;
+    int r, next = 0, turn = 0;
 
+    #pragma omp parallel reduction(+:sol_id_local, bad) private(r)
+    {
+        lu_puzzle * pc = puzzle_clone(p);
+        lu_walls * wc = walls_clone(walls, p->width * p->height);
+        lu_emit * out = NULL;
+        lu_join_cursor * cur = join_cursor_new(join);
+        lu_gray * gray = (nb_coupled < nb_classes) ? gray_new(classes + nb_coupled, classes_solutions + nb_coupled, nb_classes - nb_coupled) : NULL;
+        unsigned long long n;
+
+        if(counts == NULL)
+        {
+            out = emit_new_ordered(p, wr, &turn, wr->nb_blocks * wr->block_size / omp_get_num_threads());
+            for(;;)
+            {
+                //Un compteur partagé distribue les intervalles dans l'ordre :
+                //l'intervalle dont c'est le tour est toujours en cours
+                #pragma omp atomic capture
+                r = next++;
+                if(r >= (int) nb_ranges) break;
+
+                emit_begin(out, r);
+                sol_id_local += write_range(pc, wc, classes, classes_solutions, join, cur, gray, stride, depth, nb_coupled, total * r / nb_ranges, total * (r + 1) / nb_ranges, out);
+                emit_end(out);
+            }
         }
-        if(stack_size == nb_classes)
+        else
         {
-            if(verify_solution(p,left_,right_,top_,bottom_,center_) == 1)
+            if(mapped != NULL) out = emit_new(p, NULL);
+            #pragma omp for schedule(dynamic, 1)
+            for(r = 0; r < (int) nb_ranges; r++)
             {
-                puzzle_store(p,fd);
-                sol_id_local++;
+                if(out != NULL) emit_to(out, mapped + record * counts[r], record * (counts[r + 1] - counts[r]));
+                n = write_range(pc, wc, classes, classes_solutions, join, cur, gray, stride, depth, nb_coupled, total * r / nb_ranges, total * (r + 1) / nb_ranges, out);
+                if(out == NULL) counts[r + 1] = n;
+                else if(out->overflow || (n != counts[r + 1] - counts[r])) bad++;
+                sol_id_local += n;
             }
+        }
+
+        gray_destroy(gray);
+        join_cursor_destroy(cur);
+        emit_destroy(out);
+        walls_destroy(wc);
+        puzzle_destroy(pc);
+    }
+    if(nb_bad != NULL) *nb_bad = bad;
+    return sol_id_local;
+}
 
-            --stack_size;
-            i = stack[stack_size];
-            i += remove_solution(p, classes[stack_size], &classes_solutions[stack_size].array[i]) + 1;
+//Le produit est numéroté en base mixte (la classe 0 est le chiffre de poids
+//fort) sur ses premières classes, puis découpé en intervalles d'index
+//parcourus chacun par un thread. Les intervalles sont écrits dans leur
+//ordre (voir write_ranges) : le fichier est identique à celui du parcours
+//séquentiel.
+//En code de Gray, les classes couplées sont placées d'abord et les classes
+//libres sont parcourues par gray_write() sous chaque combinaison valide.
+//Avec --mmap, un premier passage compte les grilles de chaque intervalle ;
+//le fichier est alors agrandi à sa taille finale et projeté en mémoire, et
+//le second passage écrit chaque intervalle directement à sa place.
+void write_solutions(lu_puzzle * p, lu_walls *walls, const lu_options *opt, position_array * classes, lu_bitsol * classes_solutions, unsigned int nb_classes, unsigned long long *sol_id, lu_writer *wr)
+{
+    unsigned int c, n, depth = 0, nb_coupled = nb_classes, nb_bad = 0;
+    unsigned long long total = 1, nb_ranges, *stride, sol_id_local = 0;
+    position_array * product_classes = classes;
+    lu_bitsol * product_solutions = classes_solutions;
+    lu_join * join;
+    lu_join_cursor * cur;
+    lu_gray * gray;
+    unsigned long long * counts = NULL;
+    unsigned char * mapped = NULL;
+    int r, nb_threads = omp_get_max_threads();
+
+    walls_track(walls, WALL_SHARED);
+    if(nb_classes == 0)
+    {
+        *sol_id = (walls->unsat == 0);
+        if(*sol_id) writer_write(wr, p->data, sizeof(*p->data) * p->width * p->height);
+        return;
+    }
+    remove_impossible(p);
+
+    if(opt->product == PRODUCT_GRAY)
+    {
+        product_classes = (position_array*) malloc(sizeof(position_array) * nb_classes);
+        product_solutions = (lu_bitsol*) malloc(sizeof(lu_bitsol) * nb_classes);
+        nb_coupled = 0;
+        for(c = 0; c < nb_classes; c++)
+        {
+            if(class_is_coupled(p, walls, classes[c])) nb_coupled++;
+        }
+        for(c = 0, n = 0; c < nb_classes; c++)
+        {
+            unsigned int to = class_is_coupled(p, walls, classes[c]) ? n++ : nb_coupled + c - n;
+            product_classes[to] = classes[c];
+            product_solutions[to] = classes_solutions[c];
         }
     }
+    join = join_new(p, walls, product_classes, product_solutions, nb_coupled);
+
+    stride = (unsigned long long*) malloc(sizeof(unsigned long long) * (nb_classes + 1));
+    //Assez de combinaisons des premières classes pour occuper les threads
+    while((nb_threads > 1) && (depth < nb_coupled) && (total > 0) && (total < PRODUCT_RANGES_PER_THREAD * (unsigned long long) nb_threads))
+    {
+        total *= join->classes[depth++].nb_solutions;
+    }
+    stride[depth] = 1;
+    for(c = depth; c-- > 0;)
+    {
+        stride[c] = stride[c + 1] * join->classes[c].nb_solutions;
+    }
+    nb_ranges = (total < PRODUCT_RANGES_PER_THREAD * (unsigned long long) nb_threads) ? total : PRODUCT_RANGES_PER_THREAD * (unsigned long long) nb_threads;
+
+    if(opt->map)
+    {
+        //Premier passage : les grilles de chaque intervalle sont comptées,
+        //ce qui donne la taille du fichier et la place de chaque intervalle
+        counts = (unsigned long long*) calloc(nb_ranges + 1, sizeof(unsigned long long));
+        write_ranges(p, walls, product_classes, product_solutions, join, nb_coupled, nb_classes, stride, depth, total, nb_ranges, counts, NULL, NULL, NULL);
+        for(r = 0; r < (int) nb_ranges; r++)
+        {
+            counts[r + 1] += counts[r];
+        }
+        mapped = writer_map(wr, counts[nb_ranges] * sizeof(*p->data) * p->width * p->height);
+    }
+
+    if(mapped != NULL)
+    {
+        sol_id_local = write_ranges(p, walls, product_classes, product_solutions, join, nb_coupled, nb_classes, stride, depth, total, nb_ranges, counts, mapped, &nb_bad, NULL);
+        //Les deux passages doivent trouver les mêmes grilles : une zone
+        //trop petite ou mal remplie laisse un fichier faux
+        if(nb_bad > 0)
+        {
+            fprintf(stderr, "%u product ranges do not match their mapped area, puzzle data file is invalid\n", nb_bad);
+        }
+    }
+    else if(nb_ranges <= 1)
+    {
+        lu_emit * out = emit_new(p, wr);
+
+        cur = join_cursor_new(join);
+        gray = (nb_coupled < nb_classes) ? gray_new(product_classes + nb_coupled, product_solutions + nb_coupled, nb_classes - nb_coupled) : NULL;
+        sol_id_local = write_product(p, walls, product_classes, product_solutions, join, cur, gray, 0, nb_coupled, out);
+        gray_destroy(gray);
+        join_cursor_destroy(cur);
+        emit_destroy(out);
+    }
+    else
+    {
+        sol_id_local = write_ranges(p, walls, product_classes, product_solutions, join, nb_coupled, nb_classes, stride, depth, total, nb_ranges, NULL, NULL, NULL, wr);
+    }
+
+    if(product_classes != classes)
+    {
+        free(product_classes);
+        free(product_solutions);
+    }
+    join_destroy(join);
+    free(counts);
+    free(stride);
     *sol_id = sol_id_local;
 }
 
+//Affiche le nombre de solutions calculé par le comptage
+void print_count(const lu_count *cnt)
+{
+    lu_bigint total;
+
+    count_result(cnt, &total);
+    printf("Found ");
+    bigint_print(stdout, &total);
+    printf(" solutions\n");
+    bigint_delete(&total);
+}
+
+//Même produit que write_solutions, les solutions de chaque classe sont
+//parcourues dans son ZDD au lieu d'une liste explicite
+void write_solutions_zdd(lu_puzzle * p, lu_walls *walls, position_array * classes, const lu_zdd *zdd, int * roots, unsigned int nb_classes, unsigned long long *sol_id, lu_writer *wr)
+{
+    unsigned int level = 0;
+    unsigned long long sol_id_local = 0;
+    lu_zdd_iter * iters = NULL;
+    lu_emit * out;
+    int found;
+
+    walls_track(walls, WALL_SHARED);
+    if(nb_classes == 0)
+    {
+        *sol_id = (walls->unsat == 0);
+        if(*sol_id) writer_write(wr, p->data, sizeof(*p->data) * p->width * p->height);
+        return;
+    }
+    remove_impossible(p);
 
-void solve_classes(lu_puzzle *p, position_array * pa_classes,
+    out = emit_new(p, wr);
+    iters = (lu_zdd_iter*) malloc(sizeof(lu_zdd_iter) * nb_classes);
+    for(level = 0 ; level < nb_classes ; level++)
+    {
+        zdd_iter_init(&iters[level], classes[level].size);
+    }
+
+    level = 0;
+    found = zdd_iter_first(zdd, roots[0], &iters[0]);
+    for(;;)
+    {
+        while(found && (try_solution(p, walls, classes[level], iters[level].solution.array) == 0))
+        {
+            found = zdd_iter_next(zdd, &iters[level]);
+        }
+        if(found && level + 1 < nb_classes)
+        {
+            level++;
+            found = zdd_iter_first(zdd, roots[level], &iters[level]);
+            continue;
+        }
+        if(found)
+        {
+            if(walls->unsat == 0)
+            {
+                emit_grid(out, p);
+                sol_id_local++;
+            }
+        }
+        else
+        {
+            if(level == 0) break;
+            level--;
+        }
+        remove_solution(p, walls, classes[level], iters[level].solution.array);
+        found = zdd_iter_next(zdd, &iters[level]);
+    }
+
+    for(level = 0 ; level < nb_classes ; level++)
+    {
+        zdd_iter_delete(&iters[level]);
+    }
+    free(iters);
+    emit_destroy(out);
+    *sol_id = sol_id_local;
+}
+
+void solve_classes_zdd(lu_puzzle *p, lu_walls *walls, lu_cover *cover, const lu_options *opt, position_array * pa_classes,
         position_array * pa_impossible_classes, unsigned int pa_classes_size,
-        unsigned int *sol_id, FILE *fd) 
+        unsigned long long *sol_id, lu_writer *wr)
 {
     unsigned int index = 0;
+    int * roots = (int*) malloc(sizeof(int) * (pa_classes_size + 1));
+    lu_zdd * zdd = zdd_new();
+    lu_count * cnt = opt->count ? count_new(p, walls, pa_classes, pa_classes_size) : NULL;
+    lu_zdd_iter iter;
+    int found;
+
+    for(index = 0; index < pa_classes_size ; index++)
+    {
+        walls_track(walls, index);
+        roots[index] = zdd_compile_class(zdd, p, walls, cover, pa_classes[index], pa_impossible_classes[index]);
+        printf("Class %u: %llu solutions\n", index, zdd_count(zdd, roots[index]));
+        if(cnt != NULL)
+        {
+            count_begin_class(cnt, index);
+            zdd_iter_init(&iter, pa_classes[index].size);
+            for(found = zdd_iter_first(zdd, roots[index], &iter) ; found ; found = zdd_iter_next(zdd, &iter))
+            {
+                count_add_solution(cnt, iter.solution.array);
+            }
+            zdd_iter_delete(&iter);
+            count_end_class(cnt);
+        }
+    }
+    printf("ZDD nodes = %u\n", zdd->size);
+
+    if(cnt != NULL)
+    {
+        print_count(cnt);
+        count_destroy(cnt);
+    }
+    else
+    {
+        write_solutions_zdd(p, walls, pa_classes, zdd, roots, pa_classes_size, sol_id, wr);
+    }
+
+    zdd_destroy(zdd);
+    free(roots);
+}
+
+/*!
+ * Copies de travail d'un thread : les classes ne partagent aucune case,
+ * mais la recherche modifie les compteurs des segments et des murs, et
+ * p->data pour les grandes grilles.
+ */
+typedef struct {
+    lu_puzzle * p;
+    lu_segments * segs;
+    lu_walls * walls;
+    lu_cover * cover;
+    lu_dlx * dlx;
+    lu_frontier * fr;
+    lu_split * split;
+} lu_worker;
+
+static void worker_init(lu_worker * wk, const lu_puzzle *p, const lu_segments *segs, const lu_walls *walls, const lu_options *opt)
+{
+    wk->p = puzzle_clone(p);
+    wk->segs = segments_clone(segs);
+    wk->walls = walls_clone(walls, p->width * p->height);
+    wk->cover = cover_new(wk->segs, wk->walls);
+    wk->dlx = (opt->engine == ENGINE_DLX) ? dlx_new(wk->segs, wk->walls) : NULL;
+    wk->fr = (opt->engine == ENGINE_AUTO || opt->engine == ENGINE_FRONTIER) ? frontier_new(wk->segs, wk->walls) : NULL;
+    wk->split = (opt->order == ORDER_SPLIT) ? split_new(wk->cover) : NULL;
+}
+
+static void worker_release(lu_worker * wk)
+{
+    split_destroy(wk->split);
+    frontier_destroy(wk->fr);
+    dlx_destroy(wk->dlx);
+    cover_destroy(wk->cover);
+    walls_destroy(wk->walls);
+    segments_destroy(wk->segs);
+    puzzle_destroy(wk->p);
+}
+
+//Cherche les solutions d'une classe avec le moteur choisi
+void solve_class(lu_worker * wk, const lu_options *opt, unsigned int index, position_array pa_empty, position_array pa_impossible, int_array * solutions, unsigned int *sol_id)
+{
+    walls_track(wk->walls, index);
+    if(wk->dlx != NULL)
+    {
+        dlx_solve(wk->dlx, wk->p, index, pa_empty, pa_impossible, solutions, sol_id);
+    }
+    else if((wk->fr == NULL)
+            || ((opt->engine == ENGINE_AUTO) && !frontier_fits(pa_empty, pa_impossible))
+            || !frontier_solve(wk->fr, wk->p, index, pa_empty, pa_impossible, solutions, sol_id))
+    {
+        //Classe trop large pour la programmation dynamique
+        if(wk->split != NULL) split_solve(wk->split, wk->p, pa_empty, pa_impossible, solutions, sol_id);
+        else solve(wk->p, wk->segs, wk->walls, wk->cover, opt, pa_empty, pa_impossible, solutions, sol_id);
+    }
+}
+
+//Les plus grandes classes d'abord : (taille, index) par taille décroissante
+static int compare_class_size(const void *a, const void *b)
+{
+    const unsigned int * x = (const unsigned int *) a, * y = (const unsigned int *) b;
+    if(x[0] != y[0]) return (x[0] < y[0]) ? 1 : -1;
+    return (x[1] > y[1]) - (x[1] < y[1]);
+}
+
+//Remplace la liste des solutions d'une classe par leurs masques de bits,
+//plus compacts, dès que la classe est résolue
+static void keep_solution_bits(int_array * solutions, lu_bitsol * bits, unsigned int nb_cells)
+{
+    *bits = bitsol_from_list(solutions, nb_cells);
+    delete_int_array(solutions);
+}
+
+void solve_classes(lu_puzzle *p, lu_segments *segs, lu_walls *walls, const lu_options *opt, position_array * pa_classes,
+        position_array * pa_impossible_classes, unsigned int pa_classes_size,
+        unsigned long long *sol_id, lu_writer *wr) 
+{
+    unsigned int index = 0;
+    int k;
     int_array * classes_solutions;
+    unsigned int * classes_sol_id = (unsigned int*) malloc(sizeof(unsigned int) * (pa_classes_size + 1));
+    unsigned int * order = (unsigned int*) malloc(sizeof(unsigned int) * 2 * (pa_classes_size + 1));
+    lu_bitsol * classes_bits = (lu_bitsol*) malloc(sizeof(lu_bitsol) * (pa_classes_size + 1));
+    lu_count * cnt = NULL;
+    int * solution;
 
-    classes_solutions = (int_array*)malloc(sizeof(int_array) * pa_classes_size);
+    //Estimation du coût d'une classe : son nombre de cases
     for(index = 0; index < pa_classes_size ; index++)
     {
-        solve(p, pa_classes[index] , pa_impossible_classes[index], &classes_solutions[index], sol_id);
+        order[2 * index] = pa_classes[index].size + pa_impossible_classes[index].size;
+        order[2 * index + 1] = index;
+    }
+    qsort(order, pa_classes_size, 2 * sizeof(unsigned int), compare_class_size);
+
+    classes_solutions = (int_array*)malloc(sizeof(int_array) * pa_classes_size);
+
+    //Les grandes classes du parcours statique sont partagées entre tous les
+    //threads, une par une ; les autres sont réparties entre les threads
+    for(k = 0; k < (int) pa_classes_size ; k++)
+    {
+        index = order[2 * k + 1];
+        order[2 * k] = (omp_get_max_threads() > 1)
+            && (opt->order == ORDER_STATIC)
+            && (pa_classes[index].size >= PSEARCH_MIN_CELLS)
+            && ((opt->engine == ENGINE_DFS) || ((opt->engine == ENGINE_AUTO) && !frontier_fits(pa_classes[index], pa_impossible_classes[index])));
+        if(order[2 * k])
+        {
+            psearch_solve(p, segs, walls, index, pa_classes[index], pa_impossible_classes[index], &classes_solutions[index], &classes_sol_id[index]);
+            if(!opt->count) keep_solution_bits(&classes_solutions[index], &classes_bits[index], pa_classes[index].size);
+        }
+    }
+
+    #pragma omp parallel private(index)
+    {
+        lu_worker wk;
+        worker_init(&wk, p, segs, walls, opt);
+
+        #pragma omp for schedule(dynamic, 1)
+        for(k = 0; k < (int) pa_classes_size ; k++)
+        {
+            if(order[2 * k]) continue;
+            index = order[2 * k + 1];
+            solve_class(&wk, opt, index, pa_classes[index], pa_impossible_classes[index], &classes_solutions[index], &classes_sol_id[index]);
+            if(!opt->count) keep_solution_bits(&classes_solutions[index], &classes_bits[index], pa_classes[index].size);
+        }
+
+        worker_release(&wk);
     }
+    free(order);
+    free(classes_sol_id);
 
-    write_solutions(p, pa_classes, classes_solutions, pa_classes_size, sol_id, fd);
+    if(opt->count)
+    {
+        //Seules les signatures des murs partagés sont gardées
+        cnt = count_new(p, walls, pa_classes, pa_classes_size);
+        for(index = 0; index < pa_classes_size ; index++)
+        {
+            count_begin_class(cnt, index);
+            for(solution = classes_solutions[index].array ; *solution != -2 ; solution++)
+            {
+                count_add_solution(cnt, solution);
+                while(*solution != -1) solution++;
+            }
+            count_end_class(cnt);
+            delete_int_array(&classes_solutions[index]);
+        }
+        print_count(cnt);
+        count_destroy(cnt);
+        free(classes_solutions);
+        free(classes_bits);
+        return;
+    }
+    free(classes_solutions);
+
+    write_solutions(p, walls, opt, pa_classes, classes_bits, pa_classes_size, sol_id, wr);
+    for(index = 0; index < pa_classes_size ; index++)
+    {
+        bitsol_delete(&classes_bits[index]);
+    }
+    free(classes_bits);
 }
 
 int solver_main(int argc, char **argv) {
+   lu_options opt = { ORDER_STATIC, ENGINE_AUTO, STORE_LIST, 0, PRODUCT_LEX, WRITER_DEFAULT_BUFFER, 0, 0, 0, 0 };
+   int arg;
+
+   for (arg = 3; arg < argc; ++arg) {
+      if (strcmp(argv[arg], "--order=static") == 0) {
+         opt.order = ORDER_STATIC;
+      } else if (strcmp(argv[arg], "--order=mcv") == 0) {
+         opt.order = ORDER_MCV;
+      } else if (strcmp(argv[arg], "--order=cbj") == 0) {
+         opt.order = ORDER_CBJ;
+      } else if (strcmp(argv[arg], "--order=split") == 0) {
+         opt.order = ORDER_SPLIT;
+      } else if (strcmp(argv[arg], "--engine=auto") == 0) {
+         opt.engine = ENGINE_AUTO;
+      } else if (strcmp(argv[arg], "--engine=dfs") == 0) {
+         opt.engine = ENGINE_DFS;
+      } else if (strcmp(argv[arg], "--engine=dlx") == 0) {
+         opt.engine = ENGINE_DLX;
+      } else if (strcmp(argv[arg], "--engine=frontier") == 0) {
+         opt.engine = ENGINE_FRONTIER;
+      } else if (strcmp(argv[arg], "--count") == 0) {
+         opt.count = 1;
+      } else if (strcmp(argv[arg], "--store=list") == 0) {
+         opt.store = STORE_LIST;
+      } else if (strcmp(argv[arg], "--store=zdd") == 0) {
+         opt.store = STORE_ZDD;
+      } else if (strcmp(argv[arg], "--product=lex") == 0) {
+         opt.product = PRODUCT_LEX;
+      } else if (strcmp(argv[arg], "--product=gray") == 0) {
+         opt.product = PRODUCT_GRAY;
+      } else if (strncmp(argv[arg], "--out-buffer=", 13) == 0 && atoi(argv[arg] + 13) > 0) {
+         opt.out_buffer = atoi(argv[arg] + 13);
+      } else if (strcmp(argv[arg], "--direct") == 0) {
+         opt.direct = 1;
+      } else if (strcmp(argv[arg], "--mmap") == 0) {
+         opt.map = 1;
+      } else if (strcmp(argv[arg], "--probe") == 0) {
+         opt.probe = 1;
+      } else if (strcmp(argv[arg], "--2sat") == 0) {
+         opt.twosat = 1;
+      } else {
+         argc = 0;
+      }
+   }
+
    if (argc < 3) {
       printf("Solves a ligthup puzzle\n");
-      printf("Usage: %s <problem> <output_file>\n", argv[0]);
+      printf("Usage: %s <problem> <output_file> [--order=static|mcv|cbj|split] [--engine=auto|dfs|dlx|frontier] [--store=list|zdd] [--product=lex|gray] [--count] [--out-buffer=MiB] [--direct] [--mmap] [--probe] [--2sat]\n", argv[0]);
       return EXIT_FAILURE;
    }
 
    printf("Loading %s for solving...\n", argv[1]);
    lu_puzzle *p = puzzle_load(argv[1], 1);
 
-   FILE *fd = puzzle_open_storage_file(argv[2], p->width, p->height);
-   if(setvbuf(fd, NULL, _IOFBF, p->width * p->height * 165888) == 0)
+   //En mode comptage, aucune grille n'est écrite
+   //Les grilles sont écrites par un thread dédié, en parallèle de la recherche
+   FILE *fd = NULL;
+   lu_writer *wr = NULL;
+   if(!opt.count)
    {
-       printf("New buffer allocated\n");
+       fd = puzzle_open_storage_file(argv[2], p->width, p->height);
+       wr = writer_new(fd, (size_t) opt.out_buffer << 20, opt.direct);
    }
    printf("Solving...\n");
 
    unsigned int nb_e = puzzle_count(p, lusq_empty);
    printf("Problem size = %u\n", nb_e);
 
-   unsigned int sol_id = 0;
+   unsigned long long sol_id = 0;
 
    //FIXME
    position_array positions_empty,positions_impossible, left, right, top, bottom, center;
    
-   pre_solve(p, &positions_empty, &positions_impossible, &left, &right, &top, &bottom, &center);
+   lu_segments *segs = segments_new(p);
+   pre_solve(p, segs, &opt, &positions_empty, &positions_impossible, &left, &right, &top, &bottom, &center);
    puzzle_print(p);
-   left_ = left;
-   right_ = right;
-   top_ = top;
-   bottom_ = bottom;
-   center_ = center;
 
    //int_array solutions;
    //solve(p, positions_empty, positions_impossible, &solutions, &sol_id);
@@ -1272,13 +1345,25 @@ int solver_main(int argc, char **argv) {
    
    printf("Problem size after heuristic = %u\n", positions_impossible.size + positions_empty.size);
 
-   solve_classes(p, pa_array_empty, pa_array_impossible, pa_array_size, &sol_id, fd);
+   lu_walls *walls = walls_new(p);
+   walls_set_owners(walls, p, pa_array_empty, pa_array_size);
+   lu_cover *cover = cover_new(segs, walls);
+
+   if (opt.store == STORE_ZDD) {
+      solve_classes_zdd(p, walls, cover, &opt, pa_array_empty, pa_array_impossible, pa_array_size, &sol_id, wr);
+   } else {
+      solve_classes(p, segs, walls, &opt, pa_array_empty, pa_array_impossible, pa_array_size, &sol_id, wr);
+   }
    //FIXME
 
-   printf("Found %u solutions\n", sol_id);
+   if(!opt.count) printf("Found %llu solutions\n", sol_id);
 
+   cover_destroy(cover);
+   walls_destroy(walls);
+   segments_destroy(segs);
    puzzle_destroy(p);
-   fclose(fd);
+   writer_close(wr);
+   if(fd != NULL) fclose(fd);
 
    return EXIT_SUCCESS;
 }
@@ -1,5 +1,49 @@
 #pragma once
 
+/** Ordre dans lequel la recherche d'une classe décide les cases */
+typedef enum {
+   ORDER_STATIC,  /*!< ordre de pa_empty (remplissage de classify_positions) */
+   ORDER_MCV,     /*!< case la plus contrainte d'abord (cover_pick()) */
+   ORDER_CBJ,     /*!< comme ORDER_MCV, avec analyse des conflits et nogoods (cbj_solve()) */
+   ORDER_SPLIT    /*!< comme ORDER_MCV, composantes indépendantes résolues à part (split_solve()) */
+} lu_order;
+
+/** Moteur de recherche utilisé pour chaque classe */
+typedef enum {
+   ENGINE_AUTO,      /*!< frontier_solve() pour les classes étroites, solve() sinon */
+   ENGINE_DFS,       /*!< solve() : parcours en profondeur itératif */
+   ENGINE_DLX,       /*!< dlx_solve() : dancing links */
+   ENGINE_FRONTIER   /*!< frontier_solve() dès que l'état tient, solve() sinon */
+} lu_engine;
+
+/** Stockage des solutions de chaque classe */
+typedef enum {
+   STORE_LIST,    /*!< liste explicite dans un int_array (-1 / -2) */
+   STORE_ZDD      /*!< famille compilée en ZDD (zdd_compile_class()) */
+} lu_store;
+
+/** Ordre d'écriture du produit des solutions des classes */
+typedef enum {
+   PRODUCT_LEX,   /*!< ordre lexicographique des classes */
+   PRODUCT_GRAY   /*!< classes couplées d'abord, puis code de Gray sur les classes libres (gray_write()) */
+} lu_product;
+
+/*!
+ * \struct lu_options Options du solver, lues sur la ligne de commande.
+ */
+typedef struct {
+   lu_order order;   /*!< ordre de la recherche (--order=static|mcv|cbj|split) */
+   lu_engine engine; /*!< moteur de recherche des classes (--engine=auto|dfs|dlx|frontier) */
+   lu_store store;   /*!< stockage des solutions des classes (--store=list|zdd) */
+   int count;        /*!< compte les solutions sans les écrire (--count) */
+   lu_product product;/*!< ordre du produit des classes (--product=lex|gray) */
+   int out_buffer;   /*!< mémoire du thread d'écriture en Mio (--out-buffer=N) */
+   int direct;       /*!< écriture en O_DIRECT (--direct) */
+   int map;          /*!< fichier agrandi à sa taille finale et projeté en mémoire, avec --store=list (--mmap) */
+   int probe;        /*!< sondage des cases après le pré-traitement (--probe) */
+   int twosat;       /*!< raisonnement sur les clauses binaires après le pré-traitement (--2sat) */
+} lu_options;
+
 /** 
  * Fonction principale du solver.
  * Appelée depuis le main sous Linux ou via ISDA sous windows.
@@ -0,0 +1,559 @@
+#include "propagate.h"
+
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "twosat.h"
+
+/** La case est un mur en attente */
+#define PROPAGATE_WALL 1
+/** La case est une case impossible en attente */
+#define PROPAGATE_CELL 2
+
+static __inline void propagate_push_wall(lu_propagate *pr, unsigned int idx)
+{
+   if (!(pr->queued[idx] & PROPAGATE_WALL)) {
+      pr->queued[idx] |= PROPAGATE_WALL;
+      pr->walls[pr->nb_walls++] = idx;
+   }
+}
+
+static __inline void propagate_push_cell(lu_propagate *pr, unsigned int idx)
+{
+   if (!(pr->queued[idx] & PROPAGATE_CELL)) {
+      pr->queued[idx] |= PROPAGATE_CELL;
+      pr->cells[pr->nb_cells++] = idx;
+   }
+}
+
+static __inline void propagate_push_seg(lu_propagate *pr, unsigned int s)
+{
+   if (!pr->seg_queued[s]) {
+      pr->seg_queued[s] = 1;
+      pr->seg_queue[pr->nb_segs++] = s;
+   }
+}
+
+/*!
+ * Voisins de la case idx dans la grille.
+ *
+ * \return Le nombre de voisins.
+ */
+static __inline unsigned int propagate_neighbours(const lu_puzzle *p, unsigned int idx, unsigned int *nb)
+{
+   unsigned int x = idx % p->width, y = idx / p->width, n = 0;
+
+   if (y > 0) {
+      nb[n++] = idx - p->width;
+   }
+   if (y < p->height - 1) {
+      nb[n++] = idx + p->width;
+   }
+   if (x > 0) {
+      nb[n++] = idx - 1;
+   }
+   if (x < p->width - 1) {
+      nb[n++] = idx + 1;
+   }
+   return n;
+}
+
+/*!
+ * Modifie une case et réveille ce qui peut en dépendre.
+ */
+static void propagate_set(lu_propagate *pr, lu_puzzle *p, unsigned int idx, lu_square sq)
+{
+   lu_segments *segs = pr->segs;
+   lu_square old = p->data[idx];
+   unsigned int nb[4], n, k;
+   int s[2];
+
+   if (pr->tracing) {
+      pr->trail[pr->trail_size] = idx;
+      pr->trail_old[pr->trail_size++] = old;
+   }
+   segments_set_square(segs, p, idx, sq);
+
+   n = propagate_neighbours(p, idx, nb);
+   for (k = 0; k < n; ++k) {
+      if (p->data[nb[k]] <= lusq_4) {
+         propagate_push_wall(pr, nb[k]);
+      }
+   }
+   if (old == lusq_empty) {
+      s[0] = segs->hseg[idx];
+      s[1] = segs->vseg[idx];
+      for (k = 0; k < 2; ++k) {
+         if (segs->empty[s[k]] <= 1) {
+            propagate_push_seg(pr, s[k]);
+         }
+      }
+   }
+   if (sq == lusq_impossible) {
+      propagate_push_cell(pr, idx);
+   }
+}
+
+/*!
+ * Place une ampoule, passe les cases vides/impossibles de ses deux segments
+ * à lusq_enlighted et réveille les voisins de chaque case modifiée.
+ */
+static void propagate_light_on(lu_propagate *pr, lu_puzzle *p, unsigned int idx)
+{
+   lu_segments *segs = pr->segs;
+   unsigned int i, n, c;
+   int both[2];
+
+   propagate_set(pr, p, idx, lusq_lbulb);
+
+   both[0] = segs->hseg[idx];
+   both[1] = segs->vseg[idx];
+   for (i = 0; i < 2; ++i) {
+      unsigned int s = both[i], step = segments_step(segs, s);
+
+      for (n = 0, c = segs->first[s]; n < segs->length[s]; ++n, c += step) {
+         if (p->data[c] == lusq_empty || p->data[c] == lusq_impossible) {
+            propagate_set(pr, p, c, lusq_enlighted);
+         }
+      }
+   }
+}
+
+/*!
+ * Un mur à qui il faut tous ses voisins vides sauf un : une ampoule sur une
+ * case diagonale éclairerait ses deux voisins de part et d'autre, la case
+ * diagonale est impossible (3 avec quatre voisins libres, 2 avec trois...).
+ */
+static void propagate_diagonals(lu_propagate *pr, lu_puzzle *p, unsigned int idx)
+{
+   unsigned int x = idx % p->width, y = idx / p->width, d;
+   int dx, dy;
+
+   for (dy = -1; dy <= 1; dy += 2) {
+      for (dx = -1; dx <= 1; dx += 2) {
+         if ((dx < 0 && x == 0) || (dx > 0 && x == p->width - 1)
+               || (dy < 0 && y == 0) || (dy > 0 && y == p->height - 1)) {
+            continue;
+         }
+         d = idx + dy * (int) p->width + dx;
+         if (p->data[d] == lusq_empty
+               && p->data[idx + dy * (int) p->width] == lusq_empty
+               && p->data[idx + dx] == lusq_empty) {
+            propagate_set(pr, p, d, lusq_impossible);
+         }
+      }
+   }
+}
+
+/*!
+ * Pose une ampoule sur (ou interdit) chaque case vide nb[k] pour laquelle
+ * in[k] vaut want.
+ */
+static void propagate_fix(lu_propagate *pr, lu_puzzle *p, const unsigned int *nb, unsigned int n, const unsigned char *in, unsigned char want, lu_square sq)
+{
+   unsigned int k;
+
+   for (k = 0; k < n; ++k) {
+      if (in[k] == want && p->data[nb[k]] == lusq_empty) {
+         if (sq == lusq_lbulb) {
+            propagate_light_on(pr, p, nb[k]);
+         } else {
+            propagate_set(pr, p, nb[k], sq);
+         }
+      }
+   }
+}
+
+/*!
+ * Deux murs numérotés w et v qui ont des voisins vides en commun (en
+ * diagonale, ou de part et d'autre d'une case). Les ampoules posées sur les
+ * voisins communs sont bornées par ce qu'il manque à chaque mur et par ses
+ * autres voisins vides ; ces bornes fixent parfois les voisins propres de
+ * l'un ou de l'autre (un 3 en diagonale d'un 1 : le 1 est servi par les
+ * voisins communs, ses autres voisins sont impossibles, et le 3 a besoin de
+ * ses deux voisins propres).
+ */
+static void propagate_pair(lu_propagate *pr, lu_puzzle *p, unsigned int w, unsigned int v)
+{
+   unsigned int nw[4], nv[4], n_w, n_v, i, j;
+   unsigned char cw[4] = { 0, 0, 0, 0 }, cv[4] = { 0, 0, 0, 0 };
+   int r_w = p->data[w], r_v = p->data[v], a = 0, b = 0, c = 0, lo, hi;
+
+   n_w = propagate_neighbours(p, w, nw);
+   n_v = propagate_neighbours(p, v, nv);
+   for (i = 0; i < n_w; ++i) {
+      r_w -= p->data[nw[i]] == lusq_lbulb;
+      for (j = 0; j < n_v; ++j) {
+         if (nw[i] == nv[j] && p->data[nw[i]] == lusq_empty) {
+            cw[i] = 1;
+            cv[j] = 1;
+            ++c;
+         }
+      }
+   }
+   for (j = 0; j < n_v; ++j) {
+      r_v -= p->data[nv[j]] == lusq_lbulb;
+   }
+   for (i = 0; i < n_w; ++i) {
+      a += !cw[i] && p->data[nw[i]] == lusq_empty;
+   }
+   for (j = 0; j < n_v; ++j) {
+      b += !cv[j] && p->data[nv[j]] == lusq_empty;
+   }
+   if (c == 0 || r_w < 0 || r_v < 0) {
+      return;
+   }
+
+   // ampoules sur les voisins communs : au moins lo, au plus hi
+   lo = (r_w - a > r_v - b) ? r_w - a : r_v - b;
+   lo = (lo > 0) ? lo : 0;
+   hi = (r_w < r_v) ? r_w : r_v;
+   hi = (hi < c) ? hi : c;
+   if (lo > hi) {
+      return;
+   }
+
+   if (a > 0 && r_w <= lo) {
+      propagate_fix(pr, p, nw, n_w, cw, 0, lusq_impossible);
+   } else if (a > 0 && r_w - hi >= a) {
+      propagate_fix(pr, p, nw, n_w, cw, 0, lusq_lbulb);
+   } else if (b > 0 && r_v <= lo) {
+      propagate_fix(pr, p, nv, n_v, cv, 0, lusq_impossible);
+   } else if (b > 0 && r_v - hi >= b) {
+      propagate_fix(pr, p, nv, n_v, cv, 0, lusq_lbulb);
+   } else if (hi == 0) {
+      propagate_fix(pr, p, nw, n_w, cw, 1, lusq_impossible);
+   } else if (lo == c) {
+      propagate_fix(pr, p, nw, n_w, cw, 1, lusq_lbulb);
+   }
+}
+
+/*!
+ * Murs numérotés qui partagent des voisins avec le mur idx : les quatre
+ * diagonales et les cases à deux pas en ligne droite.
+ */
+static void propagate_pairs(lu_propagate *pr, lu_puzzle *p, unsigned int idx)
+{
+   static const int off[8][2] = {
+      { -1, -1 }, { 1, -1 }, { -1, 1 }, { 1, 1 },
+      { -2, 0 }, { 2, 0 }, { 0, -2 }, { 0, 2 }
+   };
+   int x = idx % p->width, y = idx / p->width, k;
+   unsigned int v;
+
+   for (k = 0; k < 8; ++k) {
+      if (x + off[k][0] < 0 || x + off[k][0] >= (int) p->width
+            || y + off[k][1] < 0 || y + off[k][1] >= (int) p->height) {
+         continue;
+      }
+      v = (y + off[k][1]) * p->width + x + off[k][0];
+      if (p->data[v] <= lusq_4) {
+         propagate_pair(pr, p, idx, v);
+      }
+   }
+}
+
+/*!
+ * Règles d'un mur numéroté : voisins vides impossibles s'il a toutes ses
+ * ampoules, allumés s'il n'en reste que juste assez, puis règles des
+ * diagonales et des murs proches.
+ */
+static void propagate_wall(lu_propagate *pr, lu_puzzle *p, unsigned int idx)
+{
+   unsigned int nb[4], n, k, bulbs = 0, empty = 0;
+   unsigned int need = p->data[idx];
+
+   n = propagate_neighbours(p, idx, nb);
+   for (k = 0; k < n; ++k) {
+      bulbs += p->data[nb[k]] == lusq_lbulb;
+      empty += p->data[nb[k]] == lusq_empty;
+   }
+   if (bulbs > need || bulbs + empty < need) {
+      pr->conflict = 1;
+      return;
+   }
+   if (empty == 0) {
+      return;
+   }
+
+   if (bulbs >= need) {
+      for (k = 0; k < n; ++k) {
+         if (p->data[nb[k]] == lusq_empty) {
+            propagate_set(pr, p, nb[k], lusq_impossible);
+         }
+      }
+      return;
+   }
+   if (bulbs + empty == need) {
+      for (k = 0; k < n; ++k) {
+         if (p->data[nb[k]] == lusq_empty) {
+            propagate_light_on(pr, p, nb[k]);
+         }
+      }
+      return;
+   }
+
+   if (bulbs + empty == need + 1) {
+      propagate_diagonals(pr, p, idx);
+   }
+   propagate_pairs(pr, p, idx);
+}
+
+/*!
+ * Une case impossible qu'une seule case vide peut éclairer reçoit son
+ * ampoule. Si deux cases vides peuvent l'éclairer, a dans son segment
+ * horizontal et b dans le vertical, une ampoule au croisement du segment
+ * vertical de a et du segment horizontal de b les éteindrait toutes les deux
+ * et la laisserait sombre : ce croisement est impossible.
+ */
+static void propagate_cell(lu_propagate *pr, lu_puzzle *p, unsigned int idx)
+{
+   lu_segments *segs = pr->segs;
+   int h = segs->hseg[idx], v = segs->vseg[idx];
+   unsigned int a, b, e;
+
+   if (p->data[idx] != lusq_impossible) {
+      return;
+   }
+   if (segs->empty[h] + segs->empty[v] == 0) {
+      pr->conflict = 1;
+   } else if (segs->empty[h] + segs->empty[v] == 1) {
+      propagate_light_on(pr, p, segs->empty[h] ? segs->empty_xor[h] : segs->empty_xor[v]);
+   } else if (segs->empty[h] == 1 && segs->empty[v] == 1) {
+      a = segs->empty_xor[h];
+      b = segs->empty_xor[v];
+      e = (b / p->width) * p->width + a % p->width;
+      if (p->data[e] == lusq_empty && segs->vseg[e] == segs->vseg[a] && segs->hseg[e] == segs->hseg[b]) {
+         propagate_set(pr, p, e, lusq_impossible);
+      }
+   }
+}
+
+/*!
+ * Un segment qui n'a plus qu'une case vide au plus : cette case est peut-être
+ * seule à pouvoir s'éclairer, et les cases impossibles du segment n'ont
+ * peut-être plus qu'une case pour les éclairer.
+ */
+static void propagate_segment(lu_propagate *pr, lu_puzzle *p, unsigned int s)
+{
+   lu_segments *segs = pr->segs;
+   unsigned int n, c, e, step = segments_step(segs, s);
+
+   if (segs->empty[s] == 1) {
+      e = segs->empty_xor[s];
+      if (is_alone(p, segs, e / p->width, e % p->width)) {
+         propagate_light_on(pr, p, e);
+      }
+   }
+   for (n = 0, c = segs->first[s]; n < segs->length[s]; ++n, c += step) {
+      propagate_cell(pr, p, c);
+   }
+}
+
+lu_propagate *propagate_new(const lu_puzzle *p, lu_segments *segs)
+{
+   lu_propagate *pr = (lu_propagate *) malloc(sizeof(*pr));
+   unsigned int size = p->width * p->height;
+
+   pr->segs = segs;
+   pr->walls = (unsigned int *) malloc(sizeof(unsigned int) * size);
+   pr->cells = (unsigned int *) malloc(sizeof(unsigned int) * size);
+   pr->seg_queue = (unsigned int *) malloc(sizeof(unsigned int) * (segs->nb_segs + 1));
+   pr->queued = (unsigned char *) calloc(size, sizeof(unsigned char));
+   pr->seg_queued = (unsigned char *) calloc(segs->nb_segs + 1, sizeof(unsigned char));
+   pr->nb_walls = 0;
+   pr->nb_cells = 0;
+   pr->nb_segs = 0;
+   pr->conflict = 0;
+   pr->tracing = 0;
+   pr->trail = (unsigned int *) malloc(sizeof(unsigned int) * (2 * size + 1));
+   pr->trail_old = (lu_square *) malloc(sizeof(lu_square) * (2 * size + 1));
+   pr->trail_size = 0;
+
+   return pr;
+}
+
+void propagate_destroy(lu_propagate *pr)
+{
+   if (pr != NULL) {
+      free(pr->walls);
+      free(pr->cells);
+      free(pr->seg_queue);
+      free(pr->queued);
+      free(pr->seg_queued);
+      free(pr->trail);
+      free(pr->trail_old);
+      free(pr);
+   }
+}
+
+void propagate_wake_all(lu_propagate *pr, const lu_puzzle *p)
+{
+   unsigned int idx, s, size = p->width * p->height;
+
+   for (idx = 0; idx < size; ++idx) {
+      if (p->data[idx] <= lusq_4) {
+         propagate_push_wall(pr, idx);
+      } else if (p->data[idx] == lusq_impossible) {
+         propagate_push_cell(pr, idx);
+      }
+   }
+   for (s = 0; s < pr->segs->nb_segs; ++s) {
+      if (pr->segs->empty[s] <= 1) {
+         propagate_push_seg(pr, s);
+      }
+   }
+}
+
+void propagate_run(lu_propagate *pr, lu_puzzle *p)
+{
+   unsigned int idx;
+
+   // les murs d'abord : ce sont eux qui déclenchent le plus de déductions
+   while (!pr->conflict) {
+      if (pr->nb_walls > 0) {
+         idx = pr->walls[--pr->nb_walls];
+         pr->queued[idx] &= ~PROPAGATE_WALL;
+         propagate_wall(pr, p, idx);
+      } else if (pr->nb_cells > 0) {
+         idx = pr->cells[--pr->nb_cells];
+         pr->queued[idx] &= ~PROPAGATE_CELL;
+         propagate_cell(pr, p, idx);
+      } else if (pr->nb_segs > 0) {
+         idx = pr->seg_queue[--pr->nb_segs];
+         pr->seg_queued[idx] = 0;
+         propagate_segment(pr, p, idx);
+      } else {
+         return;
+      }
+   }
+
+   // contradiction : plus rien n'est en attente
+   while (pr->nb_walls > 0) {
+      pr->queued[pr->walls[--pr->nb_walls]] &= ~PROPAGATE_WALL;
+   }
+   while (pr->nb_cells > 0) {
+      pr->queued[pr->cells[--pr->nb_cells]] &= ~PROPAGATE_CELL;
+   }
+   while (pr->nb_segs > 0) {
+      pr->seg_queued[pr->seg_queue[--pr->nb_segs]] = 0;
+   }
+}
+
+/*!
+ * Essaie sq sur la case vide idx, propage, puis remet la grille dans son
+ * état de départ.
+ *
+ * \return 1 si l'essai mène à une contradiction.
+ */
+static int propagate_try(lu_propagate *pr, lu_puzzle *p, unsigned int idx, lu_square sq)
+{
+   int conflict;
+
+   pr->trail_size = 0;
+   if (sq == lusq_lbulb) {
+      propagate_light_on(pr, p, idx);
+   } else {
+      propagate_set(pr, p, idx, sq);
+   }
+   propagate_run(pr, p);
+   conflict = pr->conflict;
+
+   while (pr->trail_size > 0) {
+      --pr->trail_size;
+      segments_set_square(pr->segs, p, pr->trail[pr->trail_size], pr->trail_old[pr->trail_size]);
+   }
+   pr->conflict = 0;
+
+   return conflict;
+}
+
+/*!
+ * Applique les conclusions d'un verdict par case et les propage.
+ *
+ * \return Le nombre de cases fixées.
+ */
+static unsigned int propagate_apply(lu_propagate *pr, lu_puzzle *p, const unsigned char *verdict)
+{
+   unsigned int idx, size = p->width * p->height, fixed = 0;
+
+   for (idx = 0; idx < size; ++idx) {
+      if (verdict[idx] == 0 || p->data[idx] != lusq_empty) {
+         continue;
+      }
+      if (verdict[idx] == PROPAGATE_NO_BULB) {
+         propagate_set(pr, p, idx, lusq_impossible);
+      } else {
+         propagate_light_on(pr, p, idx);
+      }
+      propagate_run(pr, p);
+      ++fixed;
+   }
+   return fixed;
+}
+
+unsigned int propagate_twosat(lu_propagate *pr, lu_puzzle *p, unsigned int *nb_equiv)
+{
+   unsigned char *verdict = (unsigned char *) malloc(p->width * p->height);
+   unsigned int fixed = 0, round;
+   lu_twosat *ts;
+
+   do {
+      ts = twosat_new(p, pr->segs);
+      round = twosat_forced(ts, verdict);
+      *nb_equiv = ts->nb_equiv;
+      twosat_destroy(ts);
+      if (round > 0) {
+         round = propagate_apply(pr, p, verdict);
+      }
+      fixed += round;
+   } while (round > 0 && !pr->conflict);
+
+   free(verdict);
+   return fixed;
+}
+
+unsigned int propagate_probe(lu_propagate *pr, lu_puzzle *p)
+{
+   unsigned int size = p->width * p->height, fixed = 0, round;
+   unsigned char *verdict = (unsigned char *) malloc(size);
+   int idx;
+
+   do {
+      round = 0;
+      memset(verdict, 0, size);
+
+      #pragma omp parallel
+      {
+         lu_puzzle *pc = puzzle_clone(p);
+         lu_segments *sc = segments_clone(pr->segs);
+         lu_propagate *pp = propagate_new(pc, sc);
+
+         pp->tracing = 1;
+         #pragma omp for schedule(dynamic, 64)
+         for (idx = 0; idx < (int) size; ++idx) {
+            if (pc->data[idx] != lusq_empty) {
+               continue;
+            }
+            if (propagate_try(pp, pc, idx, lusq_lbulb)) {
+               verdict[idx] = PROPAGATE_NO_BULB;
+            } else if (propagate_try(pp, pc, idx, lusq_impossible)) {
+               verdict[idx] = PROPAGATE_BULB;
+            }
+         }
+
+         propagate_destroy(pp);
+         segments_destroy(sc);
+         puzzle_destroy(pc);
+      }
+
+      // les sondes partent toutes de la même grille : leurs conclusions
+      // restent vraies une fois les premières appliquées
+      round = propagate_apply(pr, p, verdict);
+      fixed += round;
+   } while (round > 0 && !pr->conflict);
+
+   free(verdict);
+   return fixed;
+}
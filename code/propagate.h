@@ -0,0 +1,102 @@
+#pragma once
+
+#include "lightup.h"
+#include "segments.h"
+#include "utils.h"
+
+/** Une ampoule sur la case mène à une contradiction */
+#define PROPAGATE_NO_BULB 1
+/** La case ne peut pas rester sans ampoule */
+#define PROPAGATE_BULB 2
+
+/*!
+ * \struct lu_propagate Propagation des déductions du pré-traitement, pilotée
+ * par des files d'attente. Chaque case modifiée ne réveille que ce qui peut
+ * en dépendre : ses murs numérotés voisins, ses deux segments quand il n'y
+ * reste plus qu'une case vide (ou aucune), et elle-même si elle devient
+ * impossible. Le coût suit le nombre de déductions, pas la taille de la
+ * grille multipliée par le nombre de passes.
+ *
+ * Règles appliquées :
+ * - un mur a toutes ses ampoules : ses voisins vides deviennent impossibles ;
+ * - un mur n'a plus que le nombre de voisins vides qu'il lui faut : ils
+ *   reçoivent une ampoule ;
+ * - une case impossible qu'une seule case vide peut éclairer : cette case
+ *   reçoit une ampoule ;
+ * - une case vide qu'aucune autre ne peut éclairer reçoit une ampoule ;
+ * - un mur à qui il faut tous ses voisins vides sauf un : ses cases
+ *   diagonales entre deux voisins vides sont impossibles ;
+ * - deux murs qui partagent des voisins (3 et 1 en diagonale...) : les
+ *   bornes sur les ampoules communes fixent les autres voisins ;
+ * - une ampoule qui éteindrait les deux seules cases capables d'éclairer
+ *   une case impossible est interdite.
+ *
+ * La propagation s'arrête sur une contradiction : un mur qui a trop
+ * d'ampoules ou plus assez de voisins vides, une case impossible que plus
+ * rien ne peut éclairer.
+ */
+typedef struct {
+   lu_segments *segs;         /*!< segments du puzzle, tenus à jour */
+   unsigned int *walls;       /*!< murs en attente */
+   unsigned int nb_walls;     /*!< nombre de murs en attente */
+   unsigned int *cells;       /*!< cases impossibles en attente */
+   unsigned int nb_cells;     /*!< nombre de cases en attente */
+   unsigned int *seg_queue;   /*!< segments en attente */
+   unsigned int nb_segs;      /*!< nombre de segments en attente */
+   unsigned char *queued;     /*!< files où chaque case est déjà (PROPAGATE_WALL, PROPAGATE_CELL) */
+   unsigned char *seg_queued; /*!< 1 si le segment est déjà en attente */
+   int conflict;              /*!< une règle a rencontré une contradiction */
+   int tracing;               /*!< les cases modifiées sont notées pour être restaurées */
+   unsigned int *trail;       /*!< cases modifiées depuis le début de l'essai */
+   lu_square *trail_old;      /*!< leur valeur avant modification */
+   unsigned int trail_size;   /*!< nombre de modifications notées */
+} lu_propagate;
+
+/*!
+ * Alloue les files de la propagation, vides.
+ *
+ * \param p Le puzzle.
+ * \param segs L'index des segments de \p p.
+ */
+lu_propagate *propagate_new(const lu_puzzle *p, lu_segments *segs);
+
+/*!
+ * Libère la mémoire utilisée par la propagation.
+ */
+void propagate_destroy(lu_propagate *pr);
+
+/*!
+ * Met en attente tous les murs numérotés, toutes les cases impossibles et
+ * tous les segments qui n'ont plus qu'une case vide au plus.
+ */
+void propagate_wake_all(lu_propagate *pr, const lu_puzzle *p);
+
+/*!
+ * Applique les règles jusqu'à ce que plus rien ne soit en attente, ou
+ * jusqu'à une contradiction (pr->conflict, les files sont alors vidées).
+ */
+void propagate_run(lu_propagate *pr, lu_puzzle *p);
+
+/*!
+ * Raisonnement binaire sur toute la grille (lu_twosat) : les cases forcées
+ * par les clauses à deux littéraux sont fixées et propagées, puis le graphe
+ * est reconstruit tant que cela fixe quelque chose.
+ *
+ * \param nb_equiv Reçoit le nombre de cases équivalentes à une autre dans le
+ * dernier graphe.
+ * \return Le nombre de cases fixées par le raisonnement binaire.
+ */
+unsigned int propagate_twosat(lu_propagate *pr, lu_puzzle *p, unsigned int *nb_equiv);
+
+/*!
+ * Sondage des cases vides restantes : chaque case est essayée avec une
+ * ampoule puis impossible, sur une copie privée de la grille par thread, et
+ * la propagation est déroulée puis défaite. Une ampoule qui mène à une
+ * contradiction rend la case impossible ; une case qui ne peut pas rester
+ * sans ampoule en reçoit une. Les déductions sont appliquées à p et
+ * propagées, puis les cases restantes sont sondées à nouveau tant que cela
+ * fixe quelque chose.
+ *
+ * \return Le nombre de cases fixées par les sondes.
+ */
+unsigned int propagate_probe(lu_propagate *pr, lu_puzzle *p);
@@ -0,0 +1,312 @@
+#include "psearch.h"
+
+#include "cover.h"
+
+#include <omp.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Branche en cours d'une décision */
+#define PS_HI 0         /* ampoule posée, la branche "écartée" reste à faire */
+#define PS_LO 1         /* case écartée */
+#define PS_HI_ONLY 2    /* ampoule posée, l'autre branche est volée ou hors de la tâche */
+
+/*!
+ * \struct lu_pworker Un thread de la recherche : ses copies de travail et
+ * la pile de ses décisions, partagée avec les voleurs sous le verrou.
+ */
+typedef struct {
+   lu_walls *walls;        /*!< copie des murs */
+   lu_cover *cover;        /*!< couverture sur la copie des murs */
+   omp_lock_t lock;        /*!< protège phase, nb_frames, nb_open, base et task */
+   int *frame;             /*!< index dans pa_empty de chaque décision */
+   unsigned char *phase;   /*!< branche en cours de chaque décision */
+   unsigned int nb_frames; /*!< nombre de décisions */
+   unsigned int base;      /*!< décisions du préfixe de la tâche (jamais volées) */
+   int nb_open;            /*!< décisions en PS_HI, lu sans le verrou par les voleurs */
+   lu_task *task;          /*!< tâche en cours */
+} lu_pworker;
+
+static lu_task *task_new(const int *prefix, unsigned int size)
+{
+   lu_task *task = (lu_task *) calloc(1, sizeof(*task));
+
+   task->prefix = new_int_array_with_size(size + 1);
+   if (size > 0) {
+      memcpy(task->prefix.array, prefix, sizeof(int) * size);
+   }
+   task->prefix.size = size;
+   task->solutions = new_int_array();
+
+   return task;
+}
+
+static void task_add_stolen(lu_task *task, lu_task *stolen)
+{
+   if (task->nb_stolen == task->max_stolen) {
+      task->max_stolen = task->max_stolen ? 2 * task->max_stolen : 4;
+      task->stolen = (lu_task **) realloc(task->stolen, sizeof(lu_task *) * task->max_stolen);
+   }
+   task->stolen[task->nb_stolen++] = stolen;
+}
+
+static void task_destroy(lu_task *task)
+{
+   delete_int_array(&task->prefix);
+   delete_int_array(&task->solutions);
+   free(task->stolen);
+   free(task);
+}
+
+static __inline unsigned int ps_cell(const lu_puzzle *p, position_array pa_empty, int index)
+{
+   return pa_empty.array[index].line * p->width + pa_empty.array[index].column;
+}
+
+/*!
+ * Prend chez v la branche "case écartée" non essayée la moins profonde.
+ * Le voleur est compté parmi les threads actifs avant que v ne puisse
+ * terminer.
+ *
+ * \return La tâche volée, NULL si v n'a rien à partager.
+ */
+static lu_task *psearch_steal(lu_pworker *v, int *active)
+{
+   lu_task *task = NULL;
+   unsigned int f, k;
+   int *prefix, open;
+
+   // rien à prendre : on ne gêne pas v avec son verrou
+   #pragma omp atomic read
+   open = v->nb_open;
+   if (open == 0 || !omp_test_lock(&v->lock)) {
+      return NULL;
+   }
+
+   for (f = v->base; f < v->nb_frames && v->phase[f] != PS_HI; ++f);
+   if (f < v->nb_frames) {
+      v->phase[f] = PS_HI_ONLY;
+      #pragma omp atomic
+      --v->nb_open;
+      prefix = (int *) malloc(sizeof(int) * (f + 1));
+      for (k = 0; k < f; ++k) {
+         prefix[k] = (v->phase[k] == PS_LO) ? -1 - v->frame[k] : v->frame[k];
+      }
+      prefix[f] = -1 - v->frame[f];
+      task = task_new(prefix, f + 1);
+      free(prefix);
+      task_add_stolen(v->task, task);
+      #pragma omp atomic
+      ++*active;
+   }
+
+   omp_unset_lock(&v->lock);
+   return task;
+}
+
+/*!
+ * Parcourt le sous-arbre d'une tâche : rejoue son préfixe puis décide les
+ * cases suivantes dans l'ordre de pa_empty, l'ampoule d'abord.
+ */
+static void psearch_run(lu_pworker *w, const lu_puzzle *p, position_array pa_empty, position_array pa_impossible, lu_task *task)
+{
+   unsigned int i = 0, k, top, idx;
+   int dead = cover_init(w->cover, p, pa_empty, pa_impossible), descend = 1, d;
+   unsigned char ph;
+
+   omp_set_lock(&w->lock);
+   w->task = task;
+   w->base = task->prefix.size;
+   w->nb_frames = 0;
+   omp_unset_lock(&w->lock);
+
+   for (k = 0; k < task->prefix.size; ++k) {
+      d = task->prefix.array[k];
+      if (d >= 0) {
+         idx = ps_cell(p, pa_empty, d);
+         w->frame[k] = d;
+         w->phase[k] = PS_HI_ONLY;
+         walls_bulb_on(w->walls, idx);
+         dead |= cover_bulb_on(w->cover, p, idx);
+      } else {
+         idx = ps_cell(p, pa_empty, -1 - d);
+         w->frame[k] = -1 - d;
+         w->phase[k] = PS_LO;
+         dead |= cover_skip(w->cover, p, idx);
+      }
+      i = w->frame[k] + 1;
+   }
+   omp_set_lock(&w->lock);
+   w->nb_frames = task->prefix.size;
+   omp_unset_lock(&w->lock);
+
+   for (;;) {
+      if (descend) {
+         while (i < pa_empty.size && !w->cover->cand[ps_cell(p, pa_empty, i)]) {
+            ++i;
+         }
+         if (dead) {
+            // branche morte
+         } else if (i >= pa_empty.size) {
+            // plus aucune candidate : toutes les cases sont éclairées
+            if (w->walls->unsat == 0) {
+               for (k = 0; k < w->nb_frames; ++k) {
+                  if (w->phase[k] != PS_LO) {
+                     add_to_int_array(&task->solutions, w->frame[k]);
+                  }
+               }
+               add_to_int_array(&task->solutions, -1);
+               ++task->nb_solutions;
+            }
+         } else {
+            w->frame[w->nb_frames] = i;
+            w->phase[w->nb_frames] = PS_HI;
+            omp_set_lock(&w->lock);
+            ++w->nb_frames;
+            #pragma omp atomic
+            ++w->nb_open;
+            omp_unset_lock(&w->lock);
+            idx = ps_cell(p, pa_empty, i);
+            walls_bulb_on(w->walls, idx);
+            dead = cover_bulb_on(w->cover, p, idx);
+            ++i;
+            continue;
+         }
+         descend = 0;
+      }
+
+      if (w->nb_frames == w->base) {
+         break;
+      }
+
+      top = w->nb_frames - 1;
+      idx = ps_cell(p, pa_empty, w->frame[top]);
+      omp_set_lock(&w->lock);
+      ph = w->phase[top];
+      if (ph == PS_HI) {
+         w->phase[top] = PS_LO;
+         #pragma omp atomic
+         --w->nb_open;
+      } else {
+         --w->nb_frames;
+      }
+      omp_unset_lock(&w->lock);
+
+      if (ph == PS_LO) {
+         cover_unskip(w->cover);
+         continue;
+      }
+      cover_bulb_off(w->cover, idx);
+      walls_bulb_off(w->walls, idx);
+      if (ph == PS_HI) {
+         // la branche avec ampoule est finie, on passe à celle sans
+         dead = cover_skip(w->cover, p, idx);
+         i = w->frame[top] + 1;
+         descend = 1;
+      }
+   }
+
+   // défait le préfixe
+   for (k = task->prefix.size; k-- > 0;) {
+      if (w->phase[k] == PS_LO) {
+         cover_unskip(w->cover);
+      } else {
+         idx = ps_cell(p, pa_empty, w->frame[k]);
+         cover_bulb_off(w->cover, idx);
+         walls_bulb_off(w->walls, idx);
+      }
+   }
+   omp_set_lock(&w->lock);
+   w->base = w->nb_frames = 0;
+   omp_unset_lock(&w->lock);
+   cover_clear(w->cover, p, pa_empty);
+}
+
+void psearch_solve(const lu_puzzle *p, const lu_segments *segs, const lu_walls *walls, int cls, position_array pa_empty, position_array pa_impossible, int_array *solutions, unsigned int *sol_id)
+{
+   int nb_threads = omp_get_max_threads(), active = 1;
+   lu_pworker *workers = (lu_pworker *) malloc(sizeof(lu_pworker) * nb_threads);
+   lu_task *root = task_new(NULL, 0), *task;
+   lu_task **stack;
+   unsigned int size = 1, nb = 0, sp = 0, k;
+
+   #pragma omp parallel num_threads(nb_threads)
+   {
+      int me = omp_get_thread_num(), n = omp_get_num_threads(), v = me, a;
+      lu_pworker *w = &workers[me];
+      lu_task *mine = (me == 0) ? root : NULL;
+
+      w->walls = walls_clone(walls, p->width * p->height);
+      walls_track(w->walls, cls);
+      w->cover = cover_new(segs, w->walls);
+      w->frame = (int *) malloc(sizeof(int) * (pa_empty.size + 1));
+      w->phase = (unsigned char *) malloc(sizeof(unsigned char) * (pa_empty.size + 1));
+      w->nb_frames = w->base = 0;
+      w->nb_open = 0;
+      w->task = NULL;
+      omp_init_lock(&w->lock);
+      #pragma omp barrier
+
+      for (;;) {
+         if (mine == NULL) {
+            #pragma omp atomic read
+            a = active;
+            if (a == 0) {
+               break;
+            }
+            v = (v + 1) % n;
+            if (v != me) {
+               mine = psearch_steal(&workers[v], &active);
+            } else {
+               // un tour sans rien trouver : le processeur revient aux
+               // threads qui travaillent
+               sched_yield();
+            }
+            continue;
+         }
+         psearch_run(w, p, pa_empty, pa_impossible, mine);
+         mine = NULL;
+         #pragma omp atomic
+         --active;
+      }
+
+      // plus aucun voleur ne peut lire la pile
+      #pragma omp barrier
+      omp_destroy_lock(&w->lock);
+      free(w->frame);
+      free(w->phase);
+      cover_destroy(w->cover);
+      walls_destroy(w->walls);
+   }
+   free(workers);
+
+   // ordre séquentiel : les solutions d'une tâche, puis ses sous-arbres
+   // volés du dernier au premier (le plus profond était essayé avant)
+   stack = (lu_task **) malloc(sizeof(lu_task *));
+   stack[sp++] = root;
+   *solutions = new_int_array();
+   while (sp > 0) {
+      task = stack[--sp];
+      if (solutions->size + task->solutions.size + 1 > solutions->max_size) {
+         solutions->max_size = (solutions->size + task->solutions.size + 1) * 2;
+         solutions->array = (int *) realloc(solutions->array, sizeof(int) * solutions->max_size);
+      }
+      memcpy(solutions->array + solutions->size, task->solutions.array, sizeof(int) * task->solutions.size);
+      solutions->size += task->solutions.size;
+      nb += task->nb_solutions;
+
+      if (sp + task->nb_stolen > size) {
+         size = 2 * (sp + task->nb_stolen);
+         stack = (lu_task **) realloc(stack, sizeof(lu_task *) * size);
+      }
+      for (k = 0; k < task->nb_stolen; ++k) {
+         stack[sp++] = task->stolen[k];
+      }
+      task_destroy(task);
+   }
+   free(stack);
+
+   add_to_int_array(solutions, -2);
+   *sol_id = nb;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "lightup.h"
+#include "segments.h"
+#include "utils.h"
+#include "walls.h"
+
+/** Taille minimale (cases vides) d'une classe pour partager sa recherche */
+#define PSEARCH_MIN_CELLS 32
+
+/*!
+ * \struct lu_task Sous-arbre de la recherche d'une classe : les décisions
+ * du préfixe (index dans pa_empty d'une ampoule, ou -1 - index d'une case
+ * écartée), ses solutions et les sous-arbres qui lui ont été volés.
+ */
+typedef struct lu_task {
+   int_array prefix;          /*!< décisions menant au sous-arbre */
+   int_array solutions;       /*!< solutions trouvées (-1 entre deux) */
+   unsigned int nb_solutions; /*!< nombre de solutions trouvées */
+   struct lu_task **stolen;   /*!< sous-arbres volés, dans l'ordre des vols */
+   unsigned int nb_stolen;    /*!< nombre de sous-arbres volés */
+   unsigned int max_stolen;   /*!< taille allouée */
+} lu_task;
+
+/*!
+ * Recherche d'une classe partagée entre les threads OpenMP. Chaque thread
+ * parcourt un sous-arbre avec ses propres copies des murs et de la
+ * couverture ; la pile de ses décisions sert de file de travail : un thread
+ * inoccupé prend chez un autre la branche "case écartée" non essayée la
+ * moins profonde. Les solutions de chaque sous-arbre sont fusionnées à la
+ * fin dans l'ordre du parcours séquentiel, le résultat est identique à
+ * celui de solve().
+ *
+ * \param p Le puzzle (lu seulement).
+ * \param segs L'index des segments (lu seulement).
+ * \param walls Les compteurs des murs, copiés par chaque thread.
+ * \param cls Numéro de la classe (voir walls_track()).
+ * \param pa_empty Cases vides de la classe.
+ * \param pa_impossible Cases impossibles de la classe.
+ * \param[out] solutions Solutions de la classe (index dans pa_empty, -1 entre
+ * deux solutions, -2 à la fin).
+ * \param[out] sol_id Nombre de solutions.
+ */
+void psearch_solve(const lu_puzzle *p, const lu_segments *segs, const lu_walls *walls, int cls, position_array pa_empty, position_array pa_impossible, int_array *solutions, unsigned int *sol_id);
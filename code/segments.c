@@ -0,0 +1,157 @@
+#include "segments.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+lu_segments *segments_new(const lu_puzzle *p)
+{
+   unsigned int x, y, s, idx;
+   unsigned int width = p->width, height = p->height;
+
+   lu_segments *segs = (lu_segments *) malloc(sizeof(*segs));
+   segs->width = width;
+   segs->height = height;
+   segs->hseg = (int *) malloc(sizeof(int) * width * height);
+   segs->vseg = (int *) malloc(sizeof(int) * width * height);
+
+   // au plus un segment par case et par direction
+   unsigned int max_segs = 2 * width * height;
+   segs->first = (unsigned int *) malloc(sizeof(unsigned int) * max_segs);
+   segs->length = (unsigned int *) malloc(sizeof(unsigned int) * max_segs);
+
+   // segments horizontaux
+   s = 0;
+   for (y = 0; y < height; ++y) {
+      int open = 0;
+      for (x = 0; x < width; ++x) {
+         idx = y * width + x;
+         if (p->data[idx] <= lusq_block_any) {
+            segs->hseg[idx] = -1;
+            open = 0;
+            continue;
+         }
+         if (!open) {
+            segs->first[s] = idx;
+            segs->length[s] = 0;
+            ++s;
+            open = 1;
+         }
+         segs->hseg[idx] = s - 1;
+         ++segs->length[s - 1];
+      }
+   }
+   segs->nb_hsegs = s;
+
+   // segments verticaux
+   for (x = 0; x < width; ++x) {
+      int open = 0;
+      for (y = 0; y < height; ++y) {
+         idx = y * width + x;
+         if (p->data[idx] <= lusq_block_any) {
+            segs->vseg[idx] = -1;
+            open = 0;
+            continue;
+         }
+         if (!open) {
+            segs->first[s] = idx;
+            segs->length[s] = 0;
+            ++s;
+            open = 1;
+         }
+         segs->vseg[idx] = s - 1;
+         ++segs->length[s - 1];
+      }
+   }
+   segs->nb_segs = s;
+
+   segs->lit = (unsigned int *) calloc(s + 1, sizeof(unsigned int));
+   segs->empty = (unsigned int *) calloc(s + 1, sizeof(unsigned int));
+   segs->empty_xor = (unsigned int *) calloc(s + 1, sizeof(unsigned int));
+
+   for (idx = 0; idx < width * height; ++idx) {
+      if (p->data[idx] == lusq_lbulb) {
+         ++segs->lit[segs->hseg[idx]];
+         ++segs->lit[segs->vseg[idx]];
+      } else if (p->data[idx] == lusq_empty) {
+         ++segs->empty[segs->hseg[idx]];
+         ++segs->empty[segs->vseg[idx]];
+         segs->empty_xor[segs->hseg[idx]] ^= idx;
+         segs->empty_xor[segs->vseg[idx]] ^= idx;
+      }
+   }
+
+   return segs;
+}
+
+/*!
+ * Copie un bloc de size octets.
+ */
+static void *segments_dup(const void *src, size_t size)
+{
+   void *dst = malloc(size);
+   memcpy(dst, src, size);
+   return dst;
+}
+
+lu_segments *segments_clone(const lu_segments *segs)
+{
+   unsigned int size = segs->width * segs->height;
+
+   lu_segments *copy = (lu_segments *) malloc(sizeof(*copy));
+   *copy = *segs;
+   copy->hseg = (int *) segments_dup(segs->hseg, sizeof(int) * size);
+   copy->vseg = (int *) segments_dup(segs->vseg, sizeof(int) * size);
+   copy->first = (unsigned int *) segments_dup(segs->first, sizeof(unsigned int) * segs->nb_segs);
+   copy->length = (unsigned int *) segments_dup(segs->length, sizeof(unsigned int) * segs->nb_segs);
+   copy->lit = (unsigned int *) segments_dup(segs->lit, sizeof(unsigned int) * (segs->nb_segs + 1));
+   copy->empty = (unsigned int *) segments_dup(segs->empty, sizeof(unsigned int) * (segs->nb_segs + 1));
+   copy->empty_xor = (unsigned int *) segments_dup(segs->empty_xor, sizeof(unsigned int) * (segs->nb_segs + 1));
+
+   return copy;
+}
+
+void segments_destroy(lu_segments *segs)
+{
+   if (segs != NULL) {
+      free(segs->hseg);
+      free(segs->vseg);
+      free(segs->first);
+      free(segs->length);
+      free(segs->lit);
+      free(segs->empty);
+      free(segs->empty_xor);
+      free(segs);
+   }
+}
+
+void segments_set_square(lu_segments *segs, lu_puzzle *p, unsigned int idx, lu_square sq)
+{
+   lu_square old = p->data[idx];
+   int h = segs->hseg[idx], v = segs->vseg[idx];
+
+   if (old == sq) {
+      return;
+   }
+
+   if (old == lusq_empty) {
+      --segs->empty[h];
+      --segs->empty[v];
+      segs->empty_xor[h] ^= idx;
+      segs->empty_xor[v] ^= idx;
+   } else if (old == lusq_lbulb) {
+      --segs->lit[h];
+      --segs->lit[v];
+   }
+
+   if (sq == lusq_empty) {
+      ++segs->empty[h];
+      ++segs->empty[v];
+      segs->empty_xor[h] ^= idx;
+      segs->empty_xor[v] ^= idx;
+   } else if (sq == lusq_lbulb) {
+      ++segs->lit[h];
+      ++segs->lit[v];
+   }
+
+   p->data[idx] = sq;
+}
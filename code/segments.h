@@ -0,0 +1,80 @@
+#pragma once
+
+#include "lightup.h"
+
+/*!
+ * \struct lu_segments Index des segments du puzzle : un segment est une suite
+ * maximale de cases (non murs) d'une même ligne ou d'une même colonne, bornée
+ * par des murs ou les bords. Chaque case non mur appartient à exactement un
+ * segment horizontal et un segment vertical. Une ampoule éclaire exactement
+ * ses deux segments, on peut donc répondre aux questions "la case est-elle
+ * allumée ?" et "combien de cases peuvent éclairer cette case ?" en O(1) à
+ * partir de compteurs par segment.
+ *
+ * Les segments [0, nb_hsegs[ sont horizontaux, les suivants verticaux.
+ * Les compteurs ne sont à jour que si toutes les modifications de p->data
+ * passent par segments_set_square().
+ */
+typedef struct {
+   unsigned int width;     /*!< largeur du puzzle */
+   unsigned int height;    /*!< hauteur du puzzle */
+   unsigned int nb_segs;   /*!< nombre total de segments */
+   unsigned int nb_hsegs;  /*!< nombre de segments horizontaux */
+   int *hseg;              /*!< segment horizontal de chaque case, -1 pour un mur */
+   int *vseg;              /*!< segment vertical de chaque case, -1 pour un mur */
+   unsigned int *first;    /*!< première case (index dans p->data) de chaque segment */
+   unsigned int *length;   /*!< nombre de cases de chaque segment */
+   unsigned int *lit;      /*!< nombre d'ampoules dans chaque segment */
+   unsigned int *empty;    /*!< nombre de cases lusq_empty dans chaque segment */
+   unsigned int *empty_xor;/*!< xor des index des cases lusq_empty du segment */
+} lu_segments;
+
+/*!
+ * Calcule les segments d'un puzzle et initialise les compteurs à partir de
+ * son contenu.
+ *
+ * \param p Le puzzle.
+ * \return L'index des segments du puzzle.
+ */
+lu_segments *segments_new(const lu_puzzle *p);
+
+/*!
+ * Copie un index de segments et ses compteurs.
+ *
+ * \param segs L'index à copier.
+ * \return La copie.
+ */
+lu_segments *segments_clone(const lu_segments *segs);
+
+/*!
+ * Libère la mémoire utilisée par un index de segments.
+ *
+ * \param segs L'index à libérer.
+ */
+void segments_destroy(lu_segments *segs);
+
+/*!
+ * Pas entre deux cases consécutives d'un segment.
+ */
+static __inline unsigned int segments_step(const lu_segments *segs, unsigned int s)
+{
+   return (s < segs->nb_hsegs) ? 1 : segs->width;
+}
+
+/*!
+ * Renvoie 1 si la case (non mur) est éclairée par une ampoule.
+ */
+static __inline int segments_is_lit(const lu_segments *segs, unsigned int idx)
+{
+   return segs->lit[segs->hseg[idx]] + segs->lit[segs->vseg[idx]] > 0;
+}
+
+/*!
+ * Modifie une case du puzzle en tenant les compteurs à jour.
+ *
+ * \param segs L'index des segments de \p p.
+ * \param p Le puzzle.
+ * \param idx Index de la case dans p->data.
+ * \param sq Nouvelle valeur de la case.
+ */
+void segments_set_square(lu_segments *segs, lu_puzzle *p, unsigned int idx, lu_square sq);
@@ -0,0 +1,417 @@
+#include "split.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*!
+ * Solutions d'une composante résolue à part : liste (index dans pa_empty,
+ * -1 après chaque solution) et début de chaque solution.
+ */
+typedef struct {
+   int_array list;
+   int_array first;
+} lu_split_mult;
+
+/*!
+ * Plage de cases d'une recherche et nombre de composantes résolues à part,
+ * avant un changement fait au noeud de profondeur depth.
+ */
+typedef struct {
+   unsigned int depth;
+   unsigned int e_lo, e_hi, i_lo, i_hi;
+   unsigned int nb_mults;
+} lu_split_range;
+
+lu_split *split_new(lu_cover *cover)
+{
+   const lu_segments *segs = cover->segs;
+
+   lu_split *sp = (lu_split *) malloc(sizeof(*sp));
+   sp->cover = cover;
+   sp->nb_nodes = segs->width * segs->height + segs->nb_segs + cover->walls->nb_walls;
+   sp->parent = (int *) malloc(sizeof(int) * sp->nb_nodes);
+   sp->label = (int *) malloc(sizeof(int) * sp->nb_nodes);
+   sp->stamp = (unsigned int *) calloc(sp->nb_nodes, sizeof(unsigned int));
+   sp->epoch = 0;
+   sp->empty = NULL;
+   sp->impossible = NULL;
+   sp->tmp = NULL;
+   sp->max_cells = 0;
+   sp->bounds = new_int_array();
+
+   return sp;
+}
+
+void split_destroy(lu_split *sp)
+{
+   if (sp != NULL) {
+      free(sp->parent);
+      free(sp->label);
+      free(sp->stamp);
+      free(sp->empty);
+      free(sp->impossible);
+      free(sp->tmp);
+      delete_int_array(&sp->bounds);
+      free(sp);
+   }
+}
+
+/*!
+ * Initialise le noeud x s'il n'a pas encore servi pendant la passe.
+ */
+static __inline void split_touch(lu_split *sp, int x)
+{
+   if (sp->stamp[x] != sp->epoch) {
+      sp->stamp[x] = sp->epoch;
+      sp->parent[x] = x;
+      sp->label[x] = -1;
+   }
+}
+
+static __inline int split_find(lu_split *sp, int x)
+{
+   while (sp->parent[x] != x) {
+      sp->parent[x] = sp->parent[sp->parent[x]];
+      x = sp->parent[x];
+   }
+   return x;
+}
+
+static __inline void split_union(lu_split *sp, int a, int b)
+{
+   split_touch(sp, a);
+   split_touch(sp, b);
+   a = split_find(sp, a);
+   b = split_find(sp, b);
+   if (a != b) {
+      sp->parent[a] = b;
+   }
+}
+
+static __inline unsigned int split_cell(const lu_puzzle *p, position pos)
+{
+   return pos.line * p->width + pos.column;
+}
+
+/*!
+ * Range les cases sombres de [lo, hi[ en tête de la plage.
+ *
+ * \return La fin des cases sombres.
+ */
+static unsigned int split_keep_dark(const lu_split *sp, const lu_puzzle *p, position *cells, unsigned int lo, unsigned int hi)
+{
+   unsigned int i, j = lo;
+   position pos;
+
+   for (i = lo; i < hi; ++i) {
+      if (cover_is_dark(sp->cover, p, split_cell(p, cells[i]))) {
+         pos = cells[i];
+         cells[i] = cells[j];
+         cells[j++] = pos;
+      }
+   }
+   return j;
+}
+
+/*!
+ * Relie une case sombre aux segments qui peuvent encore l'éclairer, et une
+ * candidate aux murs qui la touchent.
+ */
+static void split_link(lu_split *sp, unsigned int c)
+{
+   const lu_cover *cover = sp->cover;
+   const lu_segments *segs = cover->segs;
+   const lu_walls *walls = cover->walls;
+   unsigned int size = segs->width * segs->height, i;
+
+   split_touch(sp, c);
+   if (cover->avail[segs->hseg[c]] > 0) {
+      split_union(sp, c, size + segs->hseg[c]);
+   }
+   if (cover->avail[segs->vseg[c]] > 0) {
+      split_union(sp, c, size + segs->vseg[c]);
+   }
+   if (cover->cand[c]) {
+      for (i = 0; i < 4 && walls->adj[4 * c + i] >= 0; ++i) {
+         split_union(sp, c, size + segs->nb_segs + walls->adj[4 * c + i]);
+      }
+   }
+}
+
+/*!
+ * Regroupe les cases de [lo, hi[ par composante, dans l'ordre des
+ * composantes, et note le début de chacune dans bounds[first..].
+ */
+static void split_sort(lu_split *sp, const lu_puzzle *p, position *cells, unsigned int lo, unsigned int hi, unsigned int k, unsigned int first)
+{
+   int *bounds = sp->bounds.array, *cursor = bounds + 2 * (k + 1);
+   unsigned int i, j;
+   int l;
+
+   for (j = 0; j <= k; ++j) {
+      bounds[first + j] = 0;
+   }
+   for (i = lo; i < hi; ++i) {
+      ++bounds[first + 1 + sp->label[split_find(sp, split_cell(p, cells[i]))]];
+   }
+   bounds[first] = lo;
+   for (j = 0; j < k; ++j) {
+      bounds[first + j + 1] += bounds[first + j];
+      cursor[j] = bounds[first + j];
+   }
+   for (i = lo; i < hi; ++i) {
+      l = sp->label[split_find(sp, split_cell(p, cells[i]))];
+      sp->tmp[cursor[l]++] = cells[i];
+   }
+   memcpy(&cells[lo], &sp->tmp[lo], sizeof(position) * (hi - lo));
+}
+
+/*!
+ * Calcule les composantes des cases sombres de la plage ; les cases déjà
+ * éclairées sont retirées de la plage. Avec au moins deux composantes, les
+ * cases sont regroupées et sp->bounds reçoit le début de chaque composante
+ * dans empty (k + 1 valeurs) puis dans impossible (k + 1 valeurs).
+ *
+ * \return Le nombre de composantes.
+ */
+static unsigned int split_components(lu_split *sp, const lu_puzzle *p, unsigned int e_lo, unsigned int *e_hi, unsigned int i_lo, unsigned int *i_hi)
+{
+   unsigned int i, k = 0, root;
+
+   if (++sp->epoch == 0) {
+      memset(sp->stamp, 0, sizeof(unsigned int) * sp->nb_nodes);
+      sp->epoch = 1;
+   }
+
+   *e_hi = split_keep_dark(sp, p, sp->empty, e_lo, *e_hi);
+   *i_hi = split_keep_dark(sp, p, sp->impossible, i_lo, *i_hi);
+
+   for (i = e_lo; i < *e_hi; ++i) {
+      split_link(sp, split_cell(p, sp->empty[i]));
+   }
+   for (i = i_lo; i < *i_hi; ++i) {
+      split_link(sp, split_cell(p, sp->impossible[i]));
+   }
+
+   for (i = e_lo; i < *e_hi + (*i_hi - i_lo); ++i) {
+      position pos = (i < *e_hi) ? sp->empty[i] : sp->impossible[i_lo + i - *e_hi];
+      root = split_find(sp, split_cell(p, pos));
+      if (sp->label[root] < 0) {
+         sp->label[root] = k++;
+      }
+   }
+
+   if (k >= 2) {
+      sp->bounds.size = 0;
+      for (i = 0; i < 3 * (k + 1); ++i) {
+         add_to_int_array(&sp->bounds, 0);
+      }
+      split_sort(sp, p, sp->empty, e_lo, *e_hi, k, 0);
+      split_sort(sp, p, sp->impossible, i_lo, *i_hi, k, k + 1);
+   }
+
+   return k;
+}
+
+static int split_compare_int(const void *a, const void *b)
+{
+   return *(const int *) a - *(const int *) b;
+}
+
+/*!
+ * Écrit les solutions d'une feuille : les ampoules des décisions, combinées
+ * avec une solution de chaque composante résolue à part.
+ *
+ * \return Le nombre de solutions écrites.
+ */
+static unsigned int split_emit(const lu_cover *cover, const int_array *decisions, const lu_split_mult *mults, unsigned int nb_mults, int_array *odo, int_array *out)
+{
+   unsigned int i, j, n = 0, start;
+   int s;
+
+   odo->size = 0;
+   for (j = 0; j < nb_mults; ++j) {
+      add_to_int_array(odo, 0);
+   }
+
+   for (;;) {
+      start = out->size;
+      for (i = 0; i < decisions->size; ++i) {
+         if (decisions->array[i] >= 0) {
+            add_to_int_array(out, cover->rank[decisions->array[i]]);
+         }
+      }
+      for (j = 0; j < nb_mults; ++j) {
+         for (s = mults[j].first.array[odo->array[j]]; mults[j].list.array[s] != -1; ++s) {
+            add_to_int_array(out, mults[j].list.array[s]);
+         }
+      }
+      qsort(&out->array[start], out->size - start, sizeof(int), split_compare_int);
+      add_to_int_array(out, -1);
+      ++n;
+
+      // produit : odomètre sur les composantes
+      for (j = 0; j < nb_mults && ++odo->array[j] == (int) mults[j].first.size; ++j) {
+         odo->array[j] = 0;
+      }
+      if (j == nb_mults) {
+         return n;
+      }
+   }
+}
+
+/*!
+ * Énumère les solutions des cases de empty[e_lo, e_hi[ et
+ * impossible[i_lo, i_hi[, qui ne dépendent d'aucune autre case encore
+ * sombre. La couverture est rendue dans l'état où elle a été reçue.
+ *
+ * \return Le nombre de solutions ajoutées à out.
+ */
+static unsigned int split_search(lu_split *sp, const lu_puzzle *p, unsigned int e_lo, unsigned int e_hi, unsigned int i_lo, unsigned int i_hi, int_array *out)
+{
+   lu_cover *cover = sp->cover;
+   unsigned int nb_sol = 0, i, k, j, n, largest, nb_mults = 0, max_mults = 0, nb_ranges = 0, max_ranges = 0;
+   lu_split_range prev;
+   lu_split_mult *mults = NULL;
+   lu_split_range *ranges = NULL;
+   int_array decisions = new_int_array();
+   int_array bounds = new_int_array();
+   int_array odo = new_int_array();
+   int cell, dead = 0;
+
+   for (;;) {
+      if (!dead) {
+         prev.depth = decisions.size;
+         prev.e_lo = e_lo;
+         prev.e_hi = e_hi;
+         prev.i_lo = i_lo;
+         prev.i_hi = i_hi;
+         prev.nb_mults = nb_mults;
+         k = split_components(sp, p, e_lo, &e_hi, i_lo, &i_hi);
+         if (k >= 2 || e_hi != prev.e_hi || i_hi != prev.i_hi) {
+            if (nb_ranges == max_ranges) {
+               max_ranges = 2 * max_ranges + 8;
+               ranges = (lu_split_range *) realloc(ranges, sizeof(lu_split_range) * max_ranges);
+            }
+            ranges[nb_ranges++] = prev;
+         }
+
+         if (k == 0) {
+            //Toutes les cases sont éclairées
+            nb_sol += split_emit(cover, &decisions, mults, nb_mults, &odo, out);
+            dead = 1;
+         } else if (k >= 2) {
+            // la plus grande composante reste dans cette recherche
+            bounds.size = 0;
+            largest = 0;
+            for (j = 0; j < 2 * (k + 1); ++j) {
+               add_to_int_array(&bounds, sp->bounds.array[j]);
+            }
+            for (j = 1; j < k; ++j) {
+               if (bounds.array[j + 1] - bounds.array[j] + bounds.array[k + j + 2] - bounds.array[k + j + 1]
+                     > bounds.array[largest + 1] - bounds.array[largest] + bounds.array[k + largest + 2] - bounds.array[k + largest + 1]) {
+                  largest = j;
+               }
+            }
+            for (j = 0; j < k && !dead; ++j) {
+               if (j == largest) {
+                  continue;
+               }
+               if (nb_mults == max_mults) {
+                  mults = (lu_split_mult *) realloc(mults, sizeof(lu_split_mult) * (max_mults + 1));
+                  mults[max_mults].list = new_int_array();
+                  mults[max_mults].first = new_int_array();
+                  ++max_mults;
+               }
+               mults[nb_mults].list.size = 0;
+               mults[nb_mults].first.size = 0;
+               n = split_search(sp, p, bounds.array[j], bounds.array[j + 1], bounds.array[k + j + 1], bounds.array[k + j + 2], &mults[nb_mults].list);
+               for (i = 0; i < mults[nb_mults].list.size; ++i) {
+                  if (i == 0 || mults[nb_mults].list.array[i - 1] == -1) {
+                     add_to_int_array(&mults[nb_mults].first, i);
+                  }
+               }
+               ++nb_mults;
+               dead = (n == 0);
+            }
+            e_lo = bounds.array[largest];
+            e_hi = bounds.array[largest + 1];
+            i_lo = bounds.array[k + largest + 1];
+            i_hi = bounds.array[k + largest + 2];
+         }
+
+         if (!dead) {
+            position_array pa_e = { &sp->empty[e_lo], e_hi - e_lo, e_hi - e_lo };
+            position_array pa_i = { &sp->impossible[i_lo], i_hi - i_lo, i_hi - i_lo };
+
+            cell = cover_pick(cover, p, pa_e, pa_i);
+            if (cell >= 0) {
+               walls_bulb_on(cover->walls, cell);
+               dead = cover_bulb_on(cover, p, cell);
+               add_to_int_array(&decisions, cell);
+               continue;
+            }
+         }
+      }
+
+      //Retour arrière : la dernière ampoule devient une case écartée, les
+      //plages et composantes du noeud sont restaurées
+      dead = 1;
+      while (dead) {
+         while (nb_ranges > 0 && ranges[nb_ranges - 1].depth == decisions.size) {
+            prev = ranges[--nb_ranges];
+            e_lo = prev.e_lo;
+            e_hi = prev.e_hi;
+            i_lo = prev.i_lo;
+            i_hi = prev.i_hi;
+            nb_mults = prev.nb_mults;
+         }
+         if (decisions.size == 0) {
+            break;
+         }
+         cell = decisions.array[--decisions.size];
+         if (cell < 0) {
+            cover_unskip(cover);
+            continue;
+         }
+         cover_bulb_off(cover, cell);
+         walls_bulb_off(cover->walls, cell);
+         dead = cover_skip(cover, p, cell);
+         add_to_int_array(&decisions, -1 - cell);
+      }
+      if (dead) {
+         break;
+      }
+   }
+
+   for (j = 0; j < max_mults; ++j) {
+      delete_int_array(&mults[j].list);
+      delete_int_array(&mults[j].first);
+   }
+   free(mults);
+   free(ranges);
+   delete_int_array(&decisions);
+   delete_int_array(&bounds);
+   delete_int_array(&odo);
+   return nb_sol;
+}
+
+void split_solve(lu_split *sp, const lu_puzzle *p, position_array pa_empty, position_array pa_impossible, int_array *solutions, unsigned int *sol_id)
+{
+   unsigned int size = (pa_empty.size > pa_impossible.size) ? pa_empty.size : pa_impossible.size;
+   int dead = cover_init(sp->cover, p, pa_empty, pa_impossible);
+
+   if (size > sp->max_cells) {
+      sp->max_cells = size;
+      sp->empty = (position *) realloc(sp->empty, sizeof(position) * size);
+      sp->impossible = (position *) realloc(sp->impossible, sizeof(position) * size);
+      sp->tmp = (position *) realloc(sp->tmp, sizeof(position) * size);
+   }
+   memcpy(sp->empty, pa_empty.array, sizeof(position) * pa_empty.size);
+   memcpy(sp->impossible, pa_impossible.array, sizeof(position) * pa_impossible.size);
+
+   *solutions = new_int_array();
+   *sol_id = dead ? 0 : split_search(sp, p, 0, pa_empty.size, 0, pa_impossible.size, solutions);
+   add_to_int_array(solutions, -2);
+   cover_clear(sp->cover, p, pa_empty);
+}
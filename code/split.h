@@ -0,0 +1,67 @@
+#pragma once
+
+#include "cover.h"
+#include "lightup.h"
+#include "utils.h"
+
+/*!
+ * \struct lu_split Recherche d'une classe par décisions binaires (comme
+ * solve_mcv()) qui suit, à chaque noeud, les composantes indépendantes des
+ * cases encore sombres. Une union-find relie chaque case sombre aux
+ * segments qui ont encore une candidate, et chaque candidate aux murs qui
+ * la touchent : deux composantes n'ont ni segment ni mur en commun, une
+ * ampoule posée dans l'une ne change rien à l'autre.
+ *
+ * Quand les cases sombres se séparent, les plus petites composantes sont
+ * résolues à part (récursivement, donc sur au plus la moitié des cases) et
+ * la plus grande continue dans la même recherche ; chaque solution trouvée
+ * ensuite est combinée avec le produit des solutions des autres
+ * composantes. Les sous-recherches redondantes deviennent une somme de
+ * petites recherches.
+ *
+ * Les cases de la classe sont rangées dans deux tableaux permutés sur
+ * place : chaque composante en occupe une plage contiguë.
+ */
+typedef struct {
+   lu_cover *cover;           /*!< couverture de la recherche */
+   unsigned int nb_nodes;     /*!< noeuds de l'union-find : cases, segments, murs */
+   int *parent;               /*!< parent de chaque noeud */
+   int *label;                /*!< composante de chaque racine, -1 sinon */
+   unsigned int *stamp;       /*!< passe où le noeud a été initialisé */
+   unsigned int epoch;        /*!< passe courante */
+   position *empty;           /*!< cases vides de la classe, permutées */
+   position *impossible;      /*!< cases impossibles de la classe, permutées */
+   position *tmp;             /*!< tableau de travail pour les permutations */
+   unsigned int max_cells;    /*!< taille allouée des trois tableaux */
+   int_array bounds;          /*!< début de chaque composante dans empty puis dans impossible */
+} lu_split;
+
+/*!
+ * Alloue la recherche par composantes d'un puzzle.
+ *
+ * \param cover La couverture du puzzle.
+ * \return La recherche, sans classe chargée.
+ */
+lu_split *split_new(lu_cover *cover);
+
+/*!
+ * Libère la mémoire utilisée par la recherche.
+ *
+ * \param sp La recherche à libérer.
+ */
+void split_destroy(lu_split *sp);
+
+/*!
+ * Équivalent de solve_mcv() qui résout séparément les composantes
+ * indépendantes apparues pendant la recherche. Produit les mêmes
+ * solutions, triées par index.
+ *
+ * \param sp La recherche.
+ * \param p Le puzzle.
+ * \param pa_empty Cases vides de la classe.
+ * \param pa_impossible Cases impossibles de la classe.
+ * \param[out] solutions Solutions de la classe (index dans pa_empty, -1 entre
+ * deux solutions, -2 à la fin).
+ * \param[out] sol_id Nombre de solutions.
+ */
+void split_solve(lu_split *sp, const lu_puzzle *p, position_array pa_empty, position_array pa_impossible, int_array *solutions, unsigned int *sol_id);
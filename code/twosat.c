@@ -0,0 +1,400 @@
+#include "twosat.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "propagate.h"
+
+/*!
+ * Ajoute la clause (a ou b).
+ */
+static void twosat_clause(lu_twosat *ts, unsigned int a, unsigned int b)
+{
+   if (ts->nb_clauses == ts->max_clauses) {
+      ts->max_clauses = (ts->max_clauses == 0) ? 1024 : 2 * ts->max_clauses;
+      ts->clauses = (unsigned int *) realloc(ts->clauses, sizeof(unsigned int) * 2 * ts->max_clauses);
+   }
+   ts->clauses[2 * ts->nb_clauses] = a;
+   ts->clauses[2 * ts->nb_clauses + 1] = b;
+   ++ts->nb_clauses;
+}
+
+/*!
+ * Au plus un littéral vrai parmi lits[0..n[ : deux à deux jusqu'à trois,
+ * en échelle au-delà (s_i vaut 1 si l'un des i + 1 premiers est vrai).
+ */
+static void twosat_at_most_one(lu_twosat *ts, const unsigned int *lits, unsigned int n)
+{
+   unsigned int i, j, s;
+
+   if (n <= 3) {
+      for (i = 0; i < n; ++i) {
+         for (j = i + 1; j < n; ++j) {
+            twosat_clause(ts, lits[i] ^ 1, lits[j] ^ 1);
+         }
+      }
+      return;
+   }
+   for (i = 0; i + 1 < n; ++i) {
+      s = 2 * (ts->nb_vars + i);
+      twosat_clause(ts, lits[i] ^ 1, s);
+      twosat_clause(ts, s ^ 1, lits[i + 1] ^ 1);
+      if (i + 2 < n) {
+         twosat_clause(ts, s ^ 1, s + 2);
+      }
+   }
+   ts->nb_vars += n - 1;
+}
+
+/*!
+ * Clauses des murs numérotés.
+ */
+static void twosat_walls(lu_twosat *ts, const lu_puzzle *p)
+{
+   unsigned int idx, x, y, n, k, j, bulbs, lits[4];
+   int need;
+
+   for (idx = 0; idx < ts->nb_cells; ++idx) {
+      if (p->data[idx] > lusq_4) {
+         continue;
+      }
+      x = idx % p->width;
+      y = idx / p->width;
+      n = 0;
+      bulbs = 0;
+      if (y > 0) {
+         bulbs += p->data[idx - p->width] == lusq_lbulb;
+         if (p->data[idx - p->width] == lusq_empty) {
+            lits[n++] = 2 * ts->var[idx - p->width];
+         }
+      }
+      if (y < p->height - 1) {
+         bulbs += p->data[idx + p->width] == lusq_lbulb;
+         if (p->data[idx + p->width] == lusq_empty) {
+            lits[n++] = 2 * ts->var[idx + p->width];
+         }
+      }
+      if (x > 0) {
+         bulbs += p->data[idx - 1] == lusq_lbulb;
+         if (p->data[idx - 1] == lusq_empty) {
+            lits[n++] = 2 * ts->var[idx - 1];
+         }
+      }
+      if (x < p->width - 1) {
+         bulbs += p->data[idx + 1] == lusq_lbulb;
+         if (p->data[idx + 1] == lusq_empty) {
+            lits[n++] = 2 * ts->var[idx + 1];
+         }
+      }
+      need = p->data[idx] - (int) bulbs;
+      if (n < 2) {
+         continue;
+      }
+      if (need == 1) {
+         twosat_at_most_one(ts, lits, n);
+      }
+      if (need == (int) n - 1) {
+         for (k = 0; k < n; ++k) {
+            for (j = k + 1; j < n; ++j) {
+               twosat_clause(ts, lits[k], lits[j]);
+            }
+         }
+      }
+   }
+}
+
+/*!
+ * Clauses des segments (au plus une ampoule) et des cases sombres que deux
+ * cases seulement peuvent éclairer.
+ */
+static void twosat_segments(lu_twosat *ts, const lu_puzzle *p, const lu_segments *segs)
+{
+   unsigned int *start = (unsigned int *) calloc(segs->nb_segs + 1, sizeof(unsigned int));
+   unsigned int *cands = (unsigned int *) malloc(sizeof(unsigned int) * (2 * ts->nb_cell_vars + 1));
+   unsigned int *fill = (unsigned int *) malloc(sizeof(unsigned int) * (segs->nb_segs + 1));
+   unsigned int idx, s, j, k, v, n, self, seg[2], lits[2];
+
+   // littéraux « ampoule » des cases vides de chaque segment
+   for (s = 0; s < segs->nb_segs; ++s) {
+      start[s + 1] = start[s] + segs->empty[s];
+      fill[s] = start[s];
+   }
+   for (v = 0; v < ts->nb_cell_vars; ++v) {
+      idx = ts->cell[v];
+      cands[fill[segs->hseg[idx]]++] = 2 * v;
+      cands[fill[segs->vseg[idx]]++] = 2 * v;
+   }
+
+   for (s = 0; s < segs->nb_segs; ++s) {
+      if (start[s + 1] - start[s] >= 2) {
+         twosat_at_most_one(ts, cands + start[s], start[s + 1] - start[s]);
+      }
+   }
+
+   for (idx = 0; idx < ts->nb_cells; ++idx) {
+      if (p->data[idx] != lusq_empty && p->data[idx] != lusq_impossible) {
+         continue;
+      }
+      // éclaireurs de la case, autres qu'elle-même
+      self = (p->data[idx] == lusq_empty) ? 2 * (unsigned int) ts->var[idx] : 2 * ts->nb_vars;
+      seg[0] = segs->hseg[idx];
+      seg[1] = segs->vseg[idx];
+      n = 0;
+      for (j = 0; j < 2; ++j) {
+         for (k = start[seg[j]]; k < start[seg[j] + 1] && n <= 2; ++k) {
+            if (cands[k] != self) {
+               if (n < 2) {
+                  lits[n] = cands[k];
+               }
+               ++n;
+            }
+         }
+      }
+      if (p->data[idx] == lusq_empty && n == 1) {
+         // la case porte l'ampoule ou son seul autre éclaireur
+         twosat_clause(ts, self, lits[0]);
+      } else if (p->data[idx] == lusq_impossible && n == 2) {
+         twosat_clause(ts, lits[0], lits[1]);
+      }
+   }
+
+   free(start);
+   free(cands);
+   free(fill);
+}
+
+/*!
+ * Range les implications par littéral : (a ou b) donne non a -> b et
+ * non b -> a.
+ */
+static void twosat_graph(lu_twosat *ts)
+{
+   unsigned int nb_lits = 2 * ts->nb_vars, c, a, b;
+   unsigned int *fill = (unsigned int *) malloc(sizeof(unsigned int) * (nb_lits + 1));
+
+   ts->first = (unsigned int *) calloc(nb_lits + 1, sizeof(unsigned int));
+   ts->arcs = (unsigned int *) malloc(sizeof(unsigned int) * (2 * ts->nb_clauses + 1));
+   for (c = 0; c < ts->nb_clauses; ++c) {
+      ++ts->first[(ts->clauses[2 * c] ^ 1) + 1];
+      ++ts->first[(ts->clauses[2 * c + 1] ^ 1) + 1];
+   }
+   for (a = 0; a < nb_lits; ++a) {
+      ts->first[a + 1] += ts->first[a];
+      fill[a] = ts->first[a];
+   }
+   for (c = 0; c < ts->nb_clauses; ++c) {
+      a = ts->clauses[2 * c];
+      b = ts->clauses[2 * c + 1];
+      ts->arcs[fill[a ^ 1]++] = b;
+      ts->arcs[fill[b ^ 1]++] = a;
+   }
+   free(fill);
+}
+
+/*!
+ * Composantes fortement connexes (Tarjan, sans récursion). Les composantes
+ * sont numérotées dans l'ordre où elles sont fermées : un arc ne va jamais
+ * vers une composante de numéro plus grand.
+ */
+static void twosat_components(lu_twosat *ts)
+{
+   unsigned int nb_lits = 2 * ts->nb_vars, root, l, m, top = 0, depth = 0, order = 0;
+   unsigned int *index = (unsigned int *) malloc(sizeof(unsigned int) * (nb_lits + 1));
+   unsigned int *low = (unsigned int *) malloc(sizeof(unsigned int) * (nb_lits + 1));
+   unsigned int *stack = (unsigned int *) malloc(sizeof(unsigned int) * (nb_lits + 1));
+   unsigned int *call = (unsigned int *) malloc(sizeof(unsigned int) * (nb_lits + 1));
+   unsigned int *edge = (unsigned int *) malloc(sizeof(unsigned int) * (nb_lits + 1));
+   unsigned char *on_stack = (unsigned char *) calloc(nb_lits + 1, sizeof(unsigned char));
+
+   ts->comp = (unsigned int *) malloc(sizeof(unsigned int) * (nb_lits + 1));
+   ts->nb_comps = 0;
+   for (l = 0; l < nb_lits; ++l) {
+      index[l] = 0;
+   }
+
+   for (root = 0; root < nb_lits; ++root) {
+      if (index[root] != 0) {
+         continue;
+      }
+      index[root] = low[root] = ++order;
+      stack[top++] = root;
+      on_stack[root] = 1;
+      call[depth] = root;
+      edge[depth++] = ts->first[root];
+
+      while (depth > 0) {
+         l = call[depth - 1];
+         if (edge[depth - 1] < ts->first[l + 1]) {
+            m = ts->arcs[edge[depth - 1]++];
+            if (index[m] == 0) {
+               index[m] = low[m] = ++order;
+               stack[top++] = m;
+               on_stack[m] = 1;
+               call[depth] = m;
+               edge[depth++] = ts->first[m];
+            } else if (on_stack[m] && index[m] < low[l]) {
+               low[l] = index[m];
+            }
+            continue;
+         }
+
+         // tous les arcs de l sont vus
+         if (low[l] == index[l]) {
+            do {
+               m = stack[--top];
+               on_stack[m] = 0;
+               ts->comp[m] = ts->nb_comps;
+            } while (m != l);
+            ++ts->nb_comps;
+         }
+         --depth;
+         if (depth > 0 && low[l] < low[call[depth - 1]]) {
+            low[call[depth - 1]] = low[l];
+         }
+      }
+   }
+
+   free(index);
+   free(low);
+   free(stack);
+   free(call);
+   free(edge);
+   free(on_stack);
+}
+
+lu_twosat *twosat_new(const lu_puzzle *p, const lu_segments *segs)
+{
+   lu_twosat *ts = (lu_twosat *) malloc(sizeof(*ts));
+   unsigned int idx, v, *count;
+
+   ts->nb_cells = p->width * p->height;
+   ts->var = (int *) malloc(sizeof(int) * ts->nb_cells);
+   ts->cell = (unsigned int *) malloc(sizeof(unsigned int) * (ts->nb_cells + 1));
+   ts->nb_cell_vars = 0;
+   for (idx = 0; idx < ts->nb_cells; ++idx) {
+      ts->var[idx] = -1;
+      if (p->data[idx] == lusq_empty) {
+         ts->cell[ts->nb_cell_vars] = idx;
+         ts->var[idx] = ts->nb_cell_vars++;
+      }
+   }
+   ts->nb_vars = ts->nb_cell_vars;
+   ts->nb_clauses = 0;
+   ts->max_clauses = 0;
+   ts->clauses = NULL;
+
+   twosat_segments(ts, p, segs);
+   twosat_walls(ts, p);
+   twosat_graph(ts);
+   twosat_components(ts);
+
+   // cases dont le littéral « ampoule » partage sa composante avec une autre case
+   count = (unsigned int *) calloc(ts->nb_comps + 1, sizeof(unsigned int));
+   for (v = 0; v < ts->nb_cell_vars; ++v) {
+      ++count[ts->comp[2 * v]];
+      ++count[ts->comp[2 * v + 1]];
+   }
+   ts->nb_equiv = 0;
+   for (v = 0; v < ts->nb_cell_vars; ++v) {
+      ts->nb_equiv += count[ts->comp[2 * v]] > 1;
+   }
+   free(count);
+
+   return ts;
+}
+
+void twosat_destroy(lu_twosat *ts)
+{
+   if (ts != NULL) {
+      free(ts->var);
+      free(ts->cell);
+      free(ts->clauses);
+      free(ts->first);
+      free(ts->arcs);
+      free(ts->comp);
+      free(ts);
+   }
+}
+
+/*!
+ * Cherche un chemin de l vers sa négation, ou vers une composante déjà
+ * fausse, en ne parcourant que les composantes qui peuvent encore mener à la
+ * négation (numéro plus grand que le sien).
+ */
+static int twosat_implies_negation(const lu_twosat *ts, unsigned int l, const unsigned char *comp_false, unsigned int *stamp, unsigned int mark, unsigned int *stack)
+{
+   unsigned int target = ts->comp[l ^ 1], top = 0, seen = 0, m, a, c;
+
+   stack[top++] = l;
+   stamp[l] = mark;
+   while (top > 0 && seen < TWOSAT_SEARCH_MAX) {
+      m = stack[--top];
+      ++seen;
+      for (a = ts->first[m]; a < ts->first[m + 1]; ++a) {
+         c = ts->comp[ts->arcs[a]];
+         if (c == target || comp_false[c]) {
+            return 1;
+         }
+         if (c > target && stamp[ts->arcs[a]] != mark) {
+            stamp[ts->arcs[a]] = mark;
+            stack[top++] = ts->arcs[a];
+         }
+      }
+   }
+   return 0;
+}
+
+unsigned int twosat_forced(const lu_twosat *ts, unsigned char *verdict)
+{
+   unsigned int nb_lits = 2 * ts->nb_vars, v, l, forced = 0, mark = 0, found;
+   unsigned char *comp_false = (unsigned char *) calloc(ts->nb_comps + 1, sizeof(unsigned char));
+   unsigned int *stamp = (unsigned int *) calloc(nb_lits + 1, sizeof(unsigned int));
+   unsigned int *stack = (unsigned int *) malloc(sizeof(unsigned int) * (nb_lits + 1));
+   int sat = 1;
+
+   memset(verdict, 0, ts->nb_cells);
+   for (v = 0; v < ts->nb_vars; ++v) {
+      sat = sat && ts->comp[2 * v] != ts->comp[2 * v + 1];
+   }
+
+   // un chemin de l vers non l ne peut descendre que vers des numéros plus
+   // petits : seul le littéral dont la composante a le plus grand numéro est
+   // candidat. Une composante fausse peut en rendre fausse une autre déjà
+   // essayée : on recommence tant qu'il en apparaît.
+   do {
+      found = 0;
+      for (v = 0; sat && v < ts->nb_cell_vars; ++v) {
+         l = (ts->comp[2 * v] > ts->comp[2 * v + 1]) ? 2 * v : 2 * v + 1;
+         if (comp_false[ts->comp[l]] || comp_false[ts->comp[l ^ 1]]) {
+            continue;
+         }
+         if (twosat_implies_negation(ts, l, comp_false, stamp, ++mark, stack)) {
+            comp_false[ts->comp[l]] = 1;
+            ++found;
+         }
+      }
+   } while (found > 0);
+
+   // les littéraux d'une même composante sont équivalents : toutes les cases
+   // de la composante fausse sont fixées, pas seulement celle qui l'a révélée
+   for (v = 0; sat && v < ts->nb_cell_vars; ++v) {
+      if (comp_false[ts->comp[2 * v]] && comp_false[ts->comp[2 * v + 1]]) {
+         sat = 0;
+      } else if (comp_false[ts->comp[2 * v]]) {
+         verdict[ts->cell[v]] = PROPAGATE_NO_BULB;
+         ++forced;
+      } else if (comp_false[ts->comp[2 * v + 1]]) {
+         verdict[ts->cell[v]] = PROPAGATE_BULB;
+         ++forced;
+      }
+   }
+   if (!sat) {
+      memset(verdict, 0, ts->nb_cells);
+      forced = 0;
+   }
+
+   free(comp_false);
+   free(stamp);
+   free(stack);
+   return forced;
+}
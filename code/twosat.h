@@ -0,0 +1,61 @@
+#pragma once
+
+#include "lightup.h"
+#include "segments.h"
+
+/** Nombre maximum de littéraux parcourus pour décider si un littéral est forcé */
+#define TWOSAT_SEARCH_MAX 4096
+
+/*!
+ * \struct lu_twosat Graphe d'implications des contraintes binaires de la
+ * grille, une variable par case vide (1 : ampoule) :
+ * - une case sombre que deux cases seulement peuvent éclairer : (a ou b) ;
+ * - au plus une ampoule par segment, en échelle (variables auxiliaires)
+ *   au-delà de deux cases ;
+ * - un mur à qui il manque une seule ampoule : au plus un de ses voisins
+ *   vides ; un mur qui a besoin de tous ses voisins vides sauf un : au moins
+ *   un de chaque paire.
+ *
+ * Le littéral 2v dit « ampoule sur v », 2v + 1 « pas d'ampoule ». Les
+ * composantes fortement connexes regroupent les littéraux équivalents ; un
+ * littéral qui implique sa négation est faux.
+ */
+typedef struct {
+   unsigned int nb_cells;     /*!< cases de la grille */
+   unsigned int nb_vars;      /*!< variables : cases vides puis auxiliaires */
+   unsigned int nb_cell_vars; /*!< variables des cases vides */
+   int *var;                  /*!< variable de chaque case, -1 si elle n'est pas vide */
+   unsigned int *cell;        /*!< case de chaque variable de case */
+   unsigned int nb_clauses;   /*!< nombre de clauses */
+   unsigned int max_clauses;  /*!< taille allouée */
+   unsigned int *clauses;     /*!< clauses (a ou b), deux littéraux chacune */
+   unsigned int *first;       /*!< premier arc de chaque littéral */
+   unsigned int *arcs;        /*!< implications, rangées par littéral */
+   unsigned int nb_comps;     /*!< nombre de composantes */
+   unsigned int *comp;        /*!< composante de chaque littéral, en ordre topologique inverse */
+   unsigned int nb_equiv;     /*!< cases équivalentes à une autre case */
+} lu_twosat;
+
+/*!
+ * Construit le graphe d'implications de la grille et ses composantes
+ * fortement connexes.
+ *
+ * \param p Le puzzle, après propagation.
+ * \param segs L'index des segments de \p p.
+ */
+lu_twosat *twosat_new(const lu_puzzle *p, const lu_segments *segs);
+
+/*!
+ * Libère la mémoire utilisée par le graphe.
+ */
+void twosat_destroy(lu_twosat *ts);
+
+/*!
+ * Cherche les cases vides dont la valeur est forcée par les contraintes
+ * binaires. Une case équivalente à une case forcée (même composante) est
+ * forcée avec elle.
+ *
+ * \param verdict Reçoit pour chaque case PROPAGATE_NO_BULB, PROPAGATE_BULB ou 0.
+ * \return Le nombre de cases forcées, 0 si les contraintes sont contradictoires.
+ */
+unsigned int twosat_forced(const lu_twosat *ts, unsigned char *verdict);
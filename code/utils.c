@@ -38,92 +38,35 @@ inline void remove_from_position_array(position_array * pa, unsigned int index)
     pa->size--;
 }
 
-unsigned int number_of_lightbulb_possible(lu_puzzle *p, unsigned int line, unsigned int column, position * lb_pos)
+//Compte les cases vides (autres que la case elle-même) qui peuvent éclairer la
+//case (line, column), en O(1) grâce aux compteurs des segments. lb_pos reçoit
+//une de ces cases (la seule quand il n'y en a qu'une).
+unsigned int number_of_lightbulb_possible(lu_puzzle *p, const lu_segments *segs, unsigned int line, unsigned int column, position * lb_pos)
 {
-    int l = 0, c = 0, width = p-> width, height = p->height;
-    unsigned int count = 0;
-    unsigned char current_status = 0;
-    position lb_pos_local = {0,0};
-
-    for(l = line + 1; l < height ; l++)
-    {
-        current_status = p->data[l * width + column];
-        if(current_status <= lusq_block_any) break;
-        if(current_status == lusq_empty)
-        {
-            count++;
-            lb_pos_local = (position){l,column};
-        }
-    }
-    for(l = line - 1; l >= 0 ; l--)
-    {
-        current_status = p->data[l * width + column];
-        if(current_status <= lusq_block_any) break;
-        if(current_status == lusq_empty)
-        {
-            count++;
-            lb_pos_local = (position){l,column};
-        }
-    }
-
-    for(c = column + 1; l < width ; c++)
-    {
-        current_status = p->data[line * width + c];
-        if(current_status <= lusq_block_any) break;
-        if(current_status == lusq_empty)
-        {
-            count++;
-            lb_pos_local = (position){line,c};
-        }
-    }
-    for(c = column - 1; l >= 0 ; c--)
+    unsigned int idx = line * p->width + column;
+    int h = segs->hseg[idx], v = segs->vseg[idx];
+    unsigned int count_h = segs->empty[h], count_v = segs->empty[v];
+    unsigned int xor_h = segs->empty_xor[h], xor_v = segs->empty_xor[v];
+    unsigned int lb_idx;
+
+    //une case vide est comptée dans ses deux segments
+    if(p->data[idx] == lusq_empty)
     {
-        current_status = p->data[line * width + c];
-        if(current_status <= lusq_block_any) break;
-        if(current_status == lusq_empty)
-        {
-            count++;
-            lb_pos_local = (position){line,c};
-        }
+        count_h--;
+        count_v--;
+        xor_h ^= idx;
+        xor_v ^= idx;
     }
 
-    *lb_pos = lb_pos_local;
-    return count;
+    lb_idx = (count_h > 0) ? xor_h : xor_v;
+    *lb_pos = (position){lb_idx / p->width, lb_idx % p->width};
+    return count_h + count_v;
 }
 
-char is_alone(lu_puzzle *p, unsigned int line, unsigned int column)
+char is_alone(lu_puzzle *p, const lu_segments *segs, unsigned int line, unsigned int column)
 {
-    int l = 0, c = 0, width = p-> width, height = p->height;
-    unsigned int count = 0;
-    unsigned char current_status = 0;
-
-    for(l = line + 1; l < height ; l++)
-    {
-        current_status = p->data[l * width + column];
-        if(current_status == lusq_block_any) break;
-        count+= current_status == lusq_empty;
-    }
-    for(l = line - 1; l >= 0 ; l--)
-    {
-        current_status = p->data[l * width + column];
-        if(current_status <= lusq_block_any) break;
-        count+= current_status == lusq_empty;
-    }
-
-    for(c = column + 1; c < width ; c++)
-    {
-        current_status = p->data[line * width + c];
-        if(current_status <= lusq_block_any) break;
-        count+= current_status == lusq_empty;
-    }
-    for(c = column - 1; c >= 0 ; c--)
-    {
-        current_status = p->data[line * width + c];
-        if(current_status <= lusq_block_any) break;
-        count+= current_status == lusq_empty;
-    }
-
-    return count == 0;
+    position useless;
+    return number_of_lightbulb_possible(p, segs, line, column, &useless) == 0;
 }
 
 
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "lightup.h"
+#include "segments.h"
 
 #define SIZE 1024
 
@@ -17,8 +18,8 @@ position_array new_position_array_with_size(unsigned int size);
 void delete_position_array(position_array * pa);
 void add_to_position_array(position_array * pa, position p);
 inline void remove_from_position_array(position_array * pa, unsigned int index);
-unsigned int number_of_lightbulb_possible(lu_puzzle *p, unsigned int line, unsigned int column, position * lb_pos);
-char is_alone(lu_puzzle *p, unsigned int line, unsigned int column);
+unsigned int number_of_lightbulb_possible(lu_puzzle *p, const lu_segments *segs, unsigned int line, unsigned int column, position * lb_pos);
+char is_alone(lu_puzzle *p, const lu_segments *segs, unsigned int line, unsigned int column);
 
 int_array new_int_array();
 int_array new_int_array_with_size(unsigned int size);
@@ -0,0 +1,205 @@
+#include "walls.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+lu_walls *walls_new(const lu_puzzle *p)
+{
+   unsigned int x, y, idx, i, n, w;
+   unsigned int width = p->width, height = p->height;
+   int neighbours[4];
+
+   lu_walls *walls = (lu_walls *) malloc(sizeof(*walls));
+
+   walls->nb_walls = 0;
+   for (idx = 0; idx < width * height; ++idx) {
+      walls->nb_walls += p->data[idx] <= lusq_4;
+   }
+
+   // un seul bloc pour les 5 tableaux par mur
+   walls->cell = (unsigned int *) malloc(sizeof(unsigned int) * (walls->nb_walls + 1));
+   walls->need = (int *) calloc(4 * (walls->nb_walls + 1), sizeof(int));
+   walls->bulbs = walls->need + walls->nb_walls + 1;
+   walls->open = walls->bulbs + walls->nb_walls + 1;
+   walls->owner = walls->open + walls->nb_walls + 1;
+   walls->adj = (int *) malloc(sizeof(int) * 4 * width * height);
+   memset(walls->adj, -1, sizeof(int) * 4 * width * height);
+
+   w = 0;
+   for (y = 0; y < height; ++y) {
+      for (x = 0; x < width; ++x) {
+         idx = y * width + x;
+         if (p->data[idx] > lusq_4) {
+            continue;
+         }
+
+         n = 0;
+         if (x >= 1) neighbours[n++] = idx - 1;
+         if (x + 1 < width) neighbours[n++] = idx + 1;
+         if (y >= 1) neighbours[n++] = idx - width;
+         if (y + 1 < height) neighbours[n++] = idx + width;
+
+         walls->cell[w] = idx;
+         walls->need[w] = p->data[idx];
+         walls->owner[w] = WALL_FIXED;
+         for (i = 0; i < n; ++i) {
+            lu_square sq = p->data[neighbours[i]];
+            int *adj = &walls->adj[4 * neighbours[i]];
+
+            walls->bulbs[w] += sq == lusq_lbulb;
+            if (sq == lusq_empty) {
+               ++walls->open[w];
+               while (*adj >= 0) ++adj;
+               *adj = w;
+            }
+         }
+         ++w;
+      }
+   }
+
+   walls->tracked = WALL_SHARED;
+   walls->unsat = 0;
+   walls->dead = 0;
+   for (w = 0; w < walls->nb_walls; ++w) {
+      walls->dead += walls->bulbs[w] + walls->open[w] < walls->need[w];
+   }
+
+   return walls;
+}
+
+lu_walls *walls_clone(const lu_walls *walls, unsigned int size)
+{
+   lu_walls *copy = (lu_walls *) malloc(sizeof(*copy));
+
+   *copy = *walls;
+   copy->cell = (unsigned int *) malloc(sizeof(unsigned int) * (walls->nb_walls + 1));
+   memcpy(copy->cell, walls->cell, sizeof(unsigned int) * (walls->nb_walls + 1));
+   copy->need = (int *) malloc(sizeof(int) * 4 * (walls->nb_walls + 1));
+   memcpy(copy->need, walls->need, sizeof(int) * 4 * (walls->nb_walls + 1));
+   copy->bulbs = copy->need + walls->nb_walls + 1;
+   copy->open = copy->bulbs + walls->nb_walls + 1;
+   copy->owner = copy->open + walls->nb_walls + 1;
+   copy->adj = (int *) malloc(sizeof(int) * 4 * size);
+   memcpy(copy->adj, walls->adj, sizeof(int) * 4 * size);
+
+   return copy;
+}
+
+void walls_destroy(lu_walls *walls)
+{
+   if (walls != NULL) {
+      free(walls->cell);
+      free(walls->need);
+      free(walls->adj);
+      free(walls);
+   }
+}
+
+void walls_set_owners(lu_walls *walls, const lu_puzzle *p, const position_array *classes, unsigned int nb_classes)
+{
+   unsigned int c, index, w, i, size = p->width * p->height;
+   int *class_of = (int *) malloc(sizeof(int) * size);
+
+   memset(class_of, -1, sizeof(int) * size);
+   for (c = 0; c < nb_classes; ++c) {
+      for (index = 0; index < classes[c].size; ++index) {
+         class_of[classes[c].array[index].line * p->width + classes[c].array[index].column] = c;
+      }
+   }
+
+   for (w = 0; w < walls->nb_walls; ++w) {
+      walls->owner[w] = WALL_FIXED;
+   }
+   for (index = 0; index < size; ++index) {
+      for (i = 0; i < 4 && walls->adj[4 * index + i] >= 0; ++i) {
+         w = walls->adj[4 * index + i];
+         if (class_of[index] < 0) {
+            continue;
+         }
+         if (walls->owner[w] == WALL_FIXED) {
+            walls->owner[w] = class_of[index];
+         } else if (walls->owner[w] != class_of[index]) {
+            walls->owner[w] = WALL_SHARED;
+         }
+      }
+   }
+
+   free(class_of);
+}
+
+/*!
+ * Renvoie 1 si le mur est compté dans walls->unsat.
+ */
+static __inline int walls_is_tracked(const lu_walls *walls, unsigned int w)
+{
+   return (walls->tracked >= 0) ? walls->owner[w] == walls->tracked : walls->owner[w] < 0;
+}
+
+void walls_track(lu_walls *walls, int cls)
+{
+   unsigned int w;
+
+   walls->tracked = cls;
+   walls->unsat = 0;
+   for (w = 0; w < walls->nb_walls; ++w) {
+      walls->unsat += walls_is_tracked(walls, w) && walls->bulbs[w] < walls->need[w];
+   }
+}
+
+/*!
+ * Applique une variation aux compteurs d'un mur en tenant unsat et dead à
+ * jour.
+ */
+static __inline void walls_update(lu_walls *walls, unsigned int w, int dbulbs, int dopen)
+{
+   int was_dead = walls->bulbs[w] + walls->open[w] < walls->need[w];
+   int was_unsat = walls->bulbs[w] < walls->need[w];
+
+   walls->bulbs[w] += dbulbs;
+   walls->open[w] += dopen;
+
+   walls->dead += (walls->bulbs[w] + walls->open[w] < walls->need[w]) - was_dead;
+   if (walls_is_tracked(walls, w)) {
+      walls->unsat += (walls->bulbs[w] < walls->need[w]) - was_unsat;
+   }
+}
+
+void walls_bulb_on(lu_walls *walls, unsigned int idx)
+{
+   const int *adj = &walls->adj[4 * idx];
+   unsigned int i;
+
+   for (i = 0; i < 4 && adj[i] >= 0; ++i) {
+      walls_update(walls, adj[i], 1, 0);
+   }
+}
+
+void walls_bulb_off(lu_walls *walls, unsigned int idx)
+{
+   const int *adj = &walls->adj[4 * idx];
+   unsigned int i;
+
+   for (i = 0; i < 4 && adj[i] >= 0; ++i) {
+      walls_update(walls, adj[i], -1, 0);
+   }
+}
+
+void walls_close(lu_walls *walls, unsigned int idx)
+{
+   const int *adj = &walls->adj[4 * idx];
+   unsigned int i;
+
+   for (i = 0; i < 4 && adj[i] >= 0; ++i) {
+      walls_update(walls, adj[i], 0, -1);
+   }
+}
+
+void walls_reopen(lu_walls *walls, unsigned int idx)
+{
+   const int *adj = &walls->adj[4 * idx];
+   unsigned int i;
+
+   for (i = 0; i < 4 && adj[i] >= 0; ++i) {
+      walls_update(walls, adj[i], 0, 1);
+   }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "lightup.h"
+#include "utils.h"
+
+/** Propriétaire d'un mur dont les voisins vides sont dans plusieurs classes */
+#define WALL_SHARED -1
+/** Propriétaire d'un mur sans voisin vide : son nombre d'ampoules est figé */
+#define WALL_FIXED -2
+
+/*!
+ * \struct lu_walls Compteurs des murs numérotés. Chaque mur connaît le nombre
+ * d'ampoules posées autour de lui et le nombre de ses voisins vides qui
+ * peuvent encore recevoir une ampoule. Les compteurs sont mis à jour quand
+ * une ampoule est posée ou qu'un voisin est écarté (éclairé, bloqué ou
+ * dépassé par la recherche), ce qui rend les tests de saturation et de
+ * faisabilité en O(1).
+ *
+ * Un mur appartient à la classe qui contient tous ses voisins vides. La
+ * recherche d'une classe garantit que ses murs ont exactement le bon nombre
+ * d'ampoules, il ne reste que les murs partagés à vérifier lors du produit
+ * des solutions.
+ */
+typedef struct {
+   unsigned int nb_walls;  /*!< nombre de murs numérotés */
+   unsigned int *cell;     /*!< index de la case de chaque mur */
+   int *need;              /*!< nombre d'ampoules imposé par chaque mur */
+   int *bulbs;             /*!< ampoules posées autour de chaque mur */
+   int *open;              /*!< voisins pouvant encore recevoir une ampoule */
+   int *owner;             /*!< classe du mur, WALL_SHARED ou WALL_FIXED */
+   int *adj;               /*!< murs voisins de chaque case vide (4 par case, -1) */
+   int tracked;            /*!< classe suivie par unsat (ou < 0 : murs partagés/figés) */
+   unsigned int unsat;     /*!< murs suivis qui manquent d'ampoules */
+   unsigned int dead;      /*!< murs qui ne peuvent plus être satisfaits */
+} lu_walls;
+
+/*!
+ * Construit les compteurs des murs à partir du contenu du puzzle (après
+ * pre_solve()) : les cases lusq_empty sont les voisins encore sombres.
+ *
+ * \param p Le puzzle.
+ * \return Les compteurs des murs.
+ */
+lu_walls *walls_new(const lu_puzzle *p);
+
+/*!
+ * Copie les compteurs des murs, pour une recherche menée en parallèle.
+ *
+ * \param walls Les compteurs à copier.
+ * \param size Nombre de cases du puzzle.
+ * \return La copie.
+ */
+lu_walls *walls_clone(const lu_walls *walls, unsigned int size);
+
+/*!
+ * Libère la mémoire utilisée par les compteurs des murs.
+ *
+ * \param walls Les compteurs à libérer.
+ */
+void walls_destroy(lu_walls *walls);
+
+/*!
+ * Calcule la classe propriétaire de chaque mur.
+ *
+ * \param walls Les compteurs des murs.
+ * \param p Le puzzle.
+ * \param classes Cases vides de chaque classe.
+ * \param nb_classes Nombre de classes.
+ */
+void walls_set_owners(lu_walls *walls, const lu_puzzle *p, const position_array *classes, unsigned int nb_classes);
+
+/*!
+ * Choisit les murs comptés dans walls->unsat : ceux de la classe cls, ou
+ * les murs partagés et figés si cls est négatif.
+ *
+ * \param walls Les compteurs des murs.
+ * \param cls La classe à suivre.
+ */
+void walls_track(lu_walls *walls, int cls);
+
+/*!
+ * Pose une ampoule sur une case vide.
+ */
+void walls_bulb_on(lu_walls *walls, unsigned int idx);
+
+/*!
+ * Retire une ampoule posée par walls_bulb_on().
+ */
+void walls_bulb_off(lu_walls *walls, unsigned int idx);
+
+/*!
+ * Une case vide ne peut plus recevoir d'ampoule (y compris parce qu'elle en
+ * porte une).
+ */
+void walls_close(lu_walls *walls, unsigned int idx);
+
+/*!
+ * Annule walls_close().
+ */
+void walls_reopen(lu_walls *walls, unsigned int idx);
+
+/*!
+ * Indique si un des quatre murs voisins d'une case vide a déjà autant
+ * d'ampoules que son chiffre.
+ *
+ * \param walls Les compteurs des murs.
+ * \param idx Index de la case.
+ * \return 1 si un mur voisin a déjà toutes ses ampoules.
+ */
+static __inline int walls_blocked(const lu_walls *walls, unsigned int idx)
+{
+   const int *adj = &walls->adj[4 * idx];
+   unsigned int i;
+
+   for (i = 0; i < 4 && adj[i] >= 0; ++i) {
+      if (walls->bulbs[adj[i]] >= walls->need[adj[i]]) {
+         return 1;
+      }
+   }
+
+   return 0;
+}
@@ -0,0 +1,243 @@
+#define _GNU_SOURCE
+#include "writer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/*!
+ * Active ou coupe O_DIRECT sur le descripteur.
+ */
+static void writer_set_direct(lu_writer *w, int on)
+{
+   int flags = fcntl(w->fd, F_GETFL);
+
+   if (on == w->direct_on) {
+      return;
+   }
+   if (fcntl(w->fd, F_SETFL, on ? (flags | O_DIRECT) : (flags & ~O_DIRECT)) != 0) {
+      // système de fichiers sans O_DIRECT : écriture normale
+      fprintf(stderr, "O_DIRECT not supported, using buffered writes\n");
+      w->direct = 0;
+      return;
+   }
+   w->direct_on = on;
+}
+
+/*!
+ * Écrit les blocs d'un seul writev(), recommencé tant qu'il reste des
+ * octets. O_DIRECT n'est utilisé que si la position et les tailles sont
+ * alignées.
+ */
+static void writer_output(lu_writer *w, struct iovec *iov, int n)
+{
+   ssize_t written;
+   int k, aligned = w->direct && w->offset % WRITER_ALIGN == 0;
+
+   for (k = 0; k < n; ++k) {
+      aligned = aligned && iov[k].iov_len % WRITER_ALIGN == 0;
+   }
+   if (w->direct) {
+      writer_set_direct(w, aligned);
+   }
+
+   while (n > 0) {
+      written = writev(w->fd, iov, n);
+      if (written < 0) {
+         if (errno == EINTR) {
+            continue;
+         }
+         perror("Cannot write puzzle data");
+         return;
+      }
+      w->offset += written;
+      while (n > 0 && (size_t) written >= iov->iov_len) {
+         written -= iov->iov_len;
+         ++iov;
+         --n;
+      }
+      if (n > 0) {
+         iov->iov_base = (char *) iov->iov_base + written;
+         iov->iov_len -= written;
+      }
+   }
+}
+
+static void *writer_run(void *arg)
+{
+   lu_writer *w = (lu_writer *) arg;
+   struct iovec iov[WRITER_MAX_IOV];
+   unsigned int first, n, k;
+
+   pthread_mutex_lock(&w->lock);
+   for (;;) {
+      while (w->nb_full == 0 && !w->done) {
+         pthread_cond_wait(&w->cond_full, &w->lock);
+      }
+      if (w->nb_full == 0) {
+         break;
+      }
+      // blocs pleins consécutifs dans l'anneau
+      first = w->head;
+      n = w->nb_full;
+      n = (n < w->nb_blocks - first) ? n : w->nb_blocks - first;
+      n = (n < WRITER_MAX_IOV) ? n : WRITER_MAX_IOV;
+      pthread_mutex_unlock(&w->lock);
+
+      for (k = 0; k < n; ++k) {
+         iov[k].iov_base = w->block[first + k];
+         iov[k].iov_len = w->fill[first + k];
+      }
+      writer_output(w, iov, n);
+
+      pthread_mutex_lock(&w->lock);
+      w->head = (first + n) % w->nb_blocks;
+      w->nb_full -= n;
+      pthread_cond_signal(&w->cond_free);
+   }
+   pthread_mutex_unlock(&w->lock);
+
+   return NULL;
+}
+
+/*!
+ * Passe le bloc courant au thread d'écriture et attend un bloc libre.
+ */
+static void writer_submit(lu_writer *w)
+{
+   pthread_mutex_lock(&w->lock);
+   w->fill[w->tail] = w->pos;
+   ++w->nb_full;
+   pthread_cond_signal(&w->cond_full);
+   while (w->nb_full == w->nb_blocks) {
+      pthread_cond_wait(&w->cond_free, &w->lock);
+   }
+   pthread_mutex_unlock(&w->lock);
+
+   w->tail = (w->tail + 1) % w->nb_blocks;
+   w->pos = 0;
+   w->cap = w->block_size;
+}
+
+lu_writer *writer_new(FILE *fd, size_t buffer_size, int direct)
+{
+   lu_writer *w = (lu_writer *) malloc(sizeof(*w));
+   unsigned int k;
+
+   fflush(fd);
+   w->fd = fileno(fd);
+   w->offset = ftell(fd);
+   w->direct = direct;
+   w->direct_on = 0;
+   w->block_size = WRITER_BLOCK_SIZE;
+   w->nb_blocks = buffer_size / WRITER_BLOCK_SIZE;
+   w->nb_blocks = (w->nb_blocks < 2) ? 2 : w->nb_blocks;
+   w->block = (unsigned char **) malloc(sizeof(unsigned char *) * w->nb_blocks);
+   w->fill = (size_t *) malloc(sizeof(size_t) * w->nb_blocks);
+   for (k = 0; k < w->nb_blocks; ++k) {
+      if (posix_memalign((void **) &w->block[k], WRITER_ALIGN, w->block_size) != 0) {
+         w->block[k] = (unsigned char *) malloc(w->block_size);
+         w->direct = 0;
+      }
+   }
+
+   // le premier bloc complète l'en-tête jusqu'à une position alignée
+   w->tail = 0;
+   w->pos = 0;
+   w->cap = w->block_size - w->offset % WRITER_ALIGN;
+
+   w->head = 0;
+   w->nb_full = 0;
+   w->done = 0;
+   w->map = NULL;
+   w->map_size = 0;
+   pthread_mutex_init(&w->lock, NULL);
+   pthread_cond_init(&w->cond_full, NULL);
+   pthread_cond_init(&w->cond_free, NULL);
+   pthread_create(&w->thread, NULL, writer_run, w);
+
+   return w;
+}
+
+unsigned char *writer_map(lu_writer *w, unsigned long long size)
+{
+   if (w->pos > 0) {
+      writer_submit(w);
+   }
+   pthread_mutex_lock(&w->lock);
+   while (w->nb_full > 0) {
+      pthread_cond_wait(&w->cond_free, &w->lock);
+   }
+   pthread_mutex_unlock(&w->lock);
+
+   // blocs réservés sur le disque si possible : pas de SIGBUS en cours d'écriture
+   if (fallocate(w->fd, 0, w->offset, size) != 0 && ftruncate(w->fd, w->offset + size) != 0) {
+      perror("Cannot resize puzzle data file");
+      return NULL;
+   }
+   // la projection commence au début du fichier, aligné sur une page
+   w->map_size = w->offset + size;
+   w->map = (unsigned char *) mmap(NULL, w->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, w->fd, 0);
+   if (w->map == MAP_FAILED) {
+      perror("Cannot map puzzle data file");
+      w->map = NULL;
+      return NULL;
+   }
+   madvise(w->map, w->map_size, MADV_SEQUENTIAL);
+
+   return w->map + w->offset;
+}
+
+void writer_write_blocks(lu_writer *w, const void *data, size_t size)
+{
+   const unsigned char *src = (const unsigned char *) data;
+   size_t chunk;
+
+   while (size > 0) {
+      chunk = (size < w->cap - w->pos) ? size : w->cap - w->pos;
+      memcpy(w->block[w->tail] + w->pos, src, chunk);
+      w->pos += chunk;
+      src += chunk;
+      size -= chunk;
+      if (w->pos == w->cap) {
+         writer_submit(w);
+      }
+   }
+}
+
+void writer_close(lu_writer *w)
+{
+   unsigned int k;
+
+   if (w == NULL) {
+      return;
+   }
+   if (w->pos > 0) {
+      writer_submit(w);
+   }
+
+   pthread_mutex_lock(&w->lock);
+   w->done = 1;
+   pthread_cond_signal(&w->cond_full);
+   pthread_mutex_unlock(&w->lock);
+   pthread_join(w->thread, NULL);
+
+   if (w->direct) {
+      writer_set_direct(w, 0);
+   }
+   if (w->map != NULL) {
+      munmap(w->map, w->map_size);
+   }
+   pthread_mutex_destroy(&w->lock);
+   pthread_cond_destroy(&w->cond_full);
+   pthread_cond_destroy(&w->cond_free);
+   for (k = 0; k < w->nb_blocks; ++k) {
+      free(w->block[k]);
+   }
+   free(w->block);
+   free(w->fill);
+   free(w);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+/** Alignement des blocs (adresse, taille et position dans le fichier pour O_DIRECT) */
+#define WRITER_ALIGN 4096
+/** Taille d'un bloc */
+#define WRITER_BLOCK_SIZE (1 << 20)
+/** Mémoire allouée aux blocs par défaut, en Mio (--out-buffer) */
+#define WRITER_DEFAULT_BUFFER 16
+/** Nombre maximum de blocs écrits par un seul writev() */
+#define WRITER_MAX_IOV 64
+
+/*!
+ * \struct lu_writer Écriture des grilles par un thread dédié. Le solver
+ * remplit des blocs alignés, dans un anneau de taille fixe ; le thread
+ * d'écriture vide les blocs pleins avec writev(), éventuellement en O_DIRECT.
+ * La recherche ne s'arrête que si tous les blocs attendent d'être écrits.
+ *
+ * Mémoire de l'écriture : les blocs (buffer_size arrondi à au moins deux
+ * blocs, --out-buffer), plus dans le produit parallèle un tampon privé par
+ * thread qui se partagent autant (au moins une grille chacun). Le total ne
+ * dépend pas de la taille du fichier produit.
+ */
+typedef struct {
+   int fd;                 /*!< descripteur du fichier */
+   int direct;             /*!< O_DIRECT demandé (et accepté par le système) */
+   int direct_on;          /*!< O_DIRECT actif sur le descripteur */
+   long long offset;       /*!< position dans le fichier après les blocs écrits */
+   size_t block_size;      /*!< taille d'un bloc */
+   unsigned int nb_blocks; /*!< nombre de blocs */
+   unsigned char **block;  /*!< les blocs */
+   size_t *fill;           /*!< octets à écrire de chaque bloc plein */
+
+   unsigned int tail;      /*!< bloc en cours de remplissage */
+   size_t pos;             /*!< octets déjà dans ce bloc */
+   size_t cap;             /*!< capacité de ce bloc */
+
+   unsigned int head;      /*!< prochain bloc à écrire */
+   unsigned int nb_full;   /*!< blocs pleins en attente */
+   int done;               /*!< plus aucun bloc ne viendra */
+   pthread_mutex_t lock;   /*!< protège head, nb_full et done */
+   pthread_cond_t cond_full;/*!< un bloc a été rempli */
+   pthread_cond_t cond_free;/*!< un bloc a été écrit */
+   pthread_t thread;       /*!< thread d'écriture */
+
+   unsigned char *map;     /*!< fichier projeté en mémoire (writer_map()), NULL sinon */
+   size_t map_size;        /*!< taille de la projection */
+} lu_writer;
+
+/*!
+ * Lance le thread d'écriture à la suite du contenu déjà écrit dans fd. Le
+ * fichier ne doit plus être utilisé par stdio avant writer_close().
+ *
+ * \param fd Le fichier des solutions.
+ * \param buffer_size Mémoire allouée aux blocs, en octets (au moins deux blocs).
+ * \param direct Écrit les blocs en O_DIRECT si le système l'accepte.
+ */
+lu_writer *writer_new(FILE *fd, size_t buffer_size, int direct);
+
+/*!
+ * Écrit les données en attente, arrête le thread et libère la mémoire.
+ */
+void writer_close(lu_writer *w);
+
+/*!
+ * Écrit les données en attente, agrandit le fichier de size octets et le
+ * projette en mémoire : les threads y écrivent directement, sans copie ni
+ * appel système. Plus rien ne doit passer par writer_write() ensuite ; la
+ * projection est libérée par writer_close().
+ *
+ * \return Le début des size octets réservés, NULL si le fichier ne peut pas
+ * être projeté (le writer reste alors utilisable).
+ */
+unsigned char *writer_map(lu_writer *w, unsigned long long size);
+
+/*!
+ * Copie des données dont le bloc courant n'a pas la place.
+ */
+void writer_write_blocks(lu_writer *w, const void *data, size_t size);
+
+/*!
+ * Ajoute des données à la suite du fichier.
+ */
+static __inline void writer_write(lu_writer *w, const void *data, size_t size)
+{
+   if (w->pos + size < w->cap) {
+      memcpy(w->block[w->tail] + w->pos, data, size);
+      w->pos += size;
+   } else {
+      writer_write_blocks(w, data, size);
+   }
+}
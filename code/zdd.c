@@ -0,0 +1,248 @@
+#include "zdd.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ZDD_INITIAL_SIZE 1024
+
+lu_zdd *zdd_new()
+{
+   lu_zdd *z = (lu_zdd *) malloc(sizeof(*z));
+
+   z->max_size = ZDD_INITIAL_SIZE;
+   z->nodes = (lu_zdd_node *) malloc(sizeof(lu_zdd_node) * z->max_size);
+   z->next = (int *) malloc(sizeof(int) * z->max_size);
+   z->nb_buckets = ZDD_INITIAL_SIZE;
+   z->buckets = (int *) malloc(sizeof(int) * z->nb_buckets);
+   memset(z->buckets, -1, sizeof(int) * z->nb_buckets);
+
+   // terminaux : variable "infinie" pour que tout noeud soit au-dessus
+   z->nodes[ZDD_EMPTY] = (lu_zdd_node) { ~0u >> 1, ZDD_EMPTY, ZDD_EMPTY };
+   z->nodes[ZDD_BASE] = (lu_zdd_node) { ~0u >> 1, ZDD_BASE, ZDD_BASE };
+   z->size = 2;
+
+   return z;
+}
+
+void zdd_destroy(lu_zdd *z)
+{
+   if (z != NULL) {
+      free(z->nodes);
+      free(z->next);
+      free(z->buckets);
+      free(z);
+   }
+}
+
+static __inline unsigned int zdd_hash(int var, int lo, int hi)
+{
+   return ((unsigned int) var * 12582917u) ^ ((unsigned int) lo * 4256249u) ^ ((unsigned int) hi * 741457u);
+}
+
+/*!
+ * Double la taille des noeuds et de la table de hachage.
+ */
+static void zdd_grow(lu_zdd *z)
+{
+   unsigned int n, b;
+
+   z->max_size *= 2;
+   z->nodes = (lu_zdd_node *) realloc(z->nodes, sizeof(lu_zdd_node) * z->max_size);
+   z->next = (int *) realloc(z->next, sizeof(int) * z->max_size);
+
+   z->nb_buckets = z->max_size;
+   z->buckets = (int *) realloc(z->buckets, sizeof(int) * z->nb_buckets);
+   memset(z->buckets, -1, sizeof(int) * z->nb_buckets);
+   for (n = 2; n < z->size; ++n) {
+      b = zdd_hash(z->nodes[n].var, z->nodes[n].lo, z->nodes[n].hi) & (z->nb_buckets - 1);
+      z->next[n] = z->buckets[b];
+      z->buckets[b] = n;
+   }
+}
+
+int zdd_make(lu_zdd *z, int var, int lo, int hi)
+{
+   unsigned int b;
+   int n;
+
+   if (hi == ZDD_EMPTY) {
+      return lo;
+   }
+
+   b = zdd_hash(var, lo, hi) & (z->nb_buckets - 1);
+   for (n = z->buckets[b]; n >= 0; n = z->next[n]) {
+      if (z->nodes[n].var == var && z->nodes[n].lo == lo && z->nodes[n].hi == hi) {
+         return n;
+      }
+   }
+
+   if (z->size == z->max_size) {
+      zdd_grow(z);
+      b = zdd_hash(var, lo, hi) & (z->nb_buckets - 1);
+   }
+   n = z->size++;
+   z->nodes[n] = (lu_zdd_node) { var, lo, hi };
+   z->next[n] = z->buckets[b];
+   z->buckets[b] = n;
+
+   return n;
+}
+
+unsigned long long zdd_count(const lu_zdd *z, int root)
+{
+   unsigned long long *count, result;
+   int n;
+
+   if (root <= ZDD_BASE) {
+      return root;
+   }
+
+   // les fils ont un numéro plus petit que leur père
+   count = (unsigned long long *) malloc(sizeof(unsigned long long) * (root + 1));
+   count[ZDD_EMPTY] = 0;
+   count[ZDD_BASE] = 1;
+   for (n = 2; n <= root; ++n) {
+      count[n] = count[z->nodes[n].lo] + count[z->nodes[n].hi];
+   }
+   result = count[root];
+   free(count);
+
+   return result;
+}
+
+/*!
+ * Prochaine case candidate de la classe à partir de l'index i.
+ */
+static unsigned int zdd_next_candidate(const lu_cover *cover, const lu_puzzle *p, position_array pa_empty, unsigned int i)
+{
+   while (i < pa_empty.size && !cover->cand[pa_empty.array[i].line * p->width + pa_empty.array[i].column]) {
+      ++i;
+   }
+   return i;
+}
+
+int zdd_compile_class(lu_zdd *z, const lu_puzzle *p, lu_walls *walls, lu_cover *cover, position_array pa_empty, position_array pa_impossible)
+{
+   // par niveau : index de la case décidée, branche en cours, résultat de hi
+   unsigned int *var = (unsigned int *) malloc(sizeof(unsigned int) * (pa_empty.size + 1));
+   unsigned char *phase = (unsigned char *) malloc(sizeof(unsigned char) * (pa_empty.size + 1));
+   int *hi = (int *) malloc(sizeof(int) * (pa_empty.size + 1));
+   unsigned int depth = 0, i = 0, idx;
+   int dead = cover_init(cover, p, pa_empty, pa_impossible);
+   int result, descend = 1;
+
+   for (;;) {
+      if (descend) {
+         i = zdd_next_candidate(cover, p, pa_empty, i);
+         if (dead) {
+            result = ZDD_EMPTY;
+         } else if (i >= pa_empty.size) {
+            // plus aucune candidate : toutes les cases sont éclairées
+            result = (walls->unsat == 0) ? ZDD_BASE : ZDD_EMPTY;
+         } else {
+            idx = pa_empty.array[i].line * p->width + pa_empty.array[i].column;
+            var[depth] = i;
+            phase[depth] = 0;
+            ++depth;
+            walls_bulb_on(walls, idx);
+            dead = cover_bulb_on(cover, p, idx);
+            ++i;
+            continue;
+         }
+         descend = 0;
+      }
+
+      if (depth == 0) {
+         break;
+      }
+
+      idx = pa_empty.array[var[depth - 1]].line * p->width + pa_empty.array[var[depth - 1]].column;
+      if (phase[depth - 1] == 0) {
+         // la branche avec ampoule est finie, on passe à celle sans
+         hi[depth - 1] = result;
+         cover_bulb_off(cover, idx);
+         walls_bulb_off(walls, idx);
+         dead = cover_skip(cover, p, idx);
+         phase[depth - 1] = 1;
+         i = var[depth - 1] + 1;
+         descend = 1;
+      } else {
+         cover_unskip(cover);
+         --depth;
+         result = zdd_make(z, var[depth], result, hi[depth]);
+      }
+   }
+
+   cover_clear(cover, p, pa_empty);
+   free(var);
+   free(phase);
+   free(hi);
+
+   return result;
+}
+
+/*!
+ * Descend depuis le noeud n en prenant toujours la branche hi, jusqu'au
+ * terminal ZDD_BASE.
+ */
+static void zdd_iter_descend(const lu_zdd *z, lu_zdd_iter *it, int n)
+{
+   while (n > ZDD_BASE) {
+      it->path[it->depth] = n;
+      it->took_hi[it->depth] = 1;
+      ++it->depth;
+      it->solution.array[it->solution.size++] = z->nodes[n].var;
+      n = z->nodes[n].hi;
+   }
+   it->solution.array[it->solution.size] = -1;
+}
+
+void zdd_iter_init(lu_zdd_iter *it, unsigned int nb_vars)
+{
+   it->path = (int *) malloc(sizeof(int) * (nb_vars + 1));
+   it->took_hi = (unsigned char *) malloc(sizeof(unsigned char) * (nb_vars + 1));
+   it->solution = new_int_array_with_size(nb_vars + 1);
+   it->depth = 0;
+}
+
+int zdd_iter_first(const lu_zdd *z, int root, lu_zdd_iter *it)
+{
+   it->depth = 0;
+   it->solution.size = 0;
+
+   if (root == ZDD_EMPTY) {
+      it->solution.array[0] = -2;
+      return 0;
+   }
+   zdd_iter_descend(z, it, root);
+
+   return 1;
+}
+
+int zdd_iter_next(const lu_zdd *z, lu_zdd_iter *it)
+{
+   int n;
+
+   while (it->depth > 0) {
+      n = it->path[it->depth - 1];
+      if (it->took_hi[it->depth - 1]) {
+         --it->solution.size;
+         if (z->nodes[n].lo != ZDD_EMPTY) {
+            it->took_hi[it->depth - 1] = 0;
+            zdd_iter_descend(z, it, z->nodes[n].lo);
+            return 1;
+         }
+      }
+      --it->depth;
+   }
+
+   it->solution.array[0] = -2;
+   return 0;
+}
+
+void zdd_iter_delete(lu_zdd_iter *it)
+{
+   free(it->path);
+   free(it->took_hi);
+   delete_int_array(&it->solution);
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "cover.h"
+#include "lightup.h"
+#include "utils.h"
+#include "walls.h"
+
+/** Famille vide */
+#define ZDD_EMPTY 0
+/** Famille qui ne contient que l'ensemble vide */
+#define ZDD_BASE 1
+
+/*!
+ * \struct lu_zdd_node Noeud d'un ZDD : les ensembles sans la variable (lo)
+ * et ceux qui la contiennent (hi, jamais ZDD_EMPTY).
+ */
+typedef struct {
+   int var;    /*!< variable (index de la case dans pa_empty) */
+   int lo;     /*!< fils sans la variable */
+   int hi;     /*!< fils avec la variable */
+} lu_zdd_node;
+
+/*!
+ * \struct lu_zdd Gestionnaire de ZDD (zero-suppressed decision diagrams).
+ * Les noeuds sont uniques (table de hachage) : deux sous-familles égales
+ * sont un seul noeud. Un noeud est toujours créé après ses fils, ses fils
+ * ont donc un numéro plus petit.
+ */
+typedef struct {
+   lu_zdd_node *nodes;     /*!< noeuds, 0 et 1 sont les terminaux */
+   unsigned int size;      /*!< nombre de noeuds */
+   unsigned int max_size;  /*!< taille allouée */
+   int *buckets;           /*!< table de hachage : premier noeud de chaque liste */
+   int *next;              /*!< noeud suivant dans la même liste */
+   unsigned int nb_buckets;/*!< nombre de listes (puissance de 2) */
+} lu_zdd;
+
+/*!
+ * \struct lu_zdd_iter Parcours des ensembles d'une famille, dans l'ordre
+ * où la recherche statique les trouve (branche hi d'abord).
+ */
+typedef struct {
+   int *path;              /*!< noeuds du chemin courant */
+   unsigned char *took_hi; /*!< branche prise à chaque noeud du chemin */
+   unsigned int depth;     /*!< longueur du chemin */
+   int_array solution;     /*!< variables de l'ensemble courant, terminées par -1 */
+} lu_zdd_iter;
+
+/*!
+ * Alloue un gestionnaire de ZDD qui ne contient que les deux terminaux.
+ */
+lu_zdd *zdd_new();
+
+/*!
+ * Libère la mémoire utilisée par un gestionnaire de ZDD.
+ */
+void zdd_destroy(lu_zdd *z);
+
+/*!
+ * Renvoie le noeud (var, lo, hi), réduit : si hi est vide, c'est lo.
+ *
+ * \param z Le gestionnaire.
+ * \param var La variable, plus petite que celles de lo et hi.
+ * \param lo Famille des ensembles sans var.
+ * \param hi Famille des ensembles avec var (sans var).
+ * \return Le noeud.
+ */
+int zdd_make(lu_zdd *z, int var, int lo, int hi);
+
+/*!
+ * Compte les ensembles de la famille (modulo 2^64).
+ */
+unsigned long long zdd_count(const lu_zdd *z, int root);
+
+/*!
+ * Compile les solutions d'une classe en ZDD : la recherche décide les cases
+ * une à une dans l'ordre de pa_empty (ampoule ou non) en utilisant la
+ * couverture et les compteurs des murs ; les sous-familles identiques sont
+ * partagées.
+ *
+ * \param z Le gestionnaire.
+ * \param p Le puzzle.
+ * \param walls Les compteurs des murs (suivant la classe, voir walls_track()).
+ * \param cover La couverture.
+ * \param pa_empty Cases vides de la classe.
+ * \param pa_impossible Cases impossibles de la classe.
+ * \return La racine de la famille des solutions.
+ */
+int zdd_compile_class(lu_zdd *z, const lu_puzzle *p, lu_walls *walls, lu_cover *cover, position_array pa_empty, position_array pa_impossible);
+
+/*!
+ * Alloue un parcours pour des familles dont les ensembles ont au plus
+ * nb_vars variables.
+ */
+void zdd_iter_init(lu_zdd_iter *it, unsigned int nb_vars);
+
+/*!
+ * Se place sur le premier ensemble de la famille.
+ *
+ * \return 0 si la famille est vide.
+ */
+int zdd_iter_first(const lu_zdd *z, int root, lu_zdd_iter *it);
+
+/*!
+ * Passe à l'ensemble suivant.
+ *
+ * \return 0 s'il n'y en a plus.
+ */
+int zdd_iter_next(const lu_zdd *z, lu_zdd_iter *it);
+
+/*!
+ * Libère la mémoire utilisée par un parcours.
+ */
+void zdd_iter_delete(lu_zdd_iter *it);